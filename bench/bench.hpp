@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_BENCH_BENCH_HPP
+#define AQUARIUS_CXX_BENCH_BENCH_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * prevent compiler from removing computation of value.
+ */
+template <typename T>
+inline void doNotOptimize(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedNs(Clock::time_point start, Clock::time_point stop) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+}
+
+/**
+ * generate input which consists of hit tokens and miss tokens.
+ * @param size
+ * approximate input size in bytes
+ * @param hitRatio
+ * probability of hit token (0.0 - 1.0)
+ * @param hit
+ * return hit token
+ * @param miss
+ * return miss token
+ * @param seed
+ * @return
+ */
+template <typename Hit, typename Miss>
+inline std::string generate(std::size_t size, double hitRatio, Hit hit, Miss miss, unsigned int seed = 42) {
+    std::mt19937 engine(seed);
+    std::bernoulli_distribution dist(hitRatio);
+    std::string input;
+    input.reserve(size + 64);
+    while(input.size() < size) {
+        input += dist(engine) ? hit(engine) : miss(engine);
+    }
+    return input;
+}
+
+struct Result {
+    std::string name;
+    double hitRatio;
+    std::size_t bytes;      // per iteration
+    std::size_t matches;    // per iteration
+    std::size_t iteration;
+    double totalNs;
+
+    double nsPerByte() const {
+        return this->totalNs / static_cast<double>(this->bytes * this->iteration);
+    }
+
+    double nsPerMatch() const {
+        return this->matches == 0 ? 0.0 : this->totalNs / static_cast<double>(this->matches * this->iteration);
+    }
+};
+
+inline void printHeader(FILE *fp) {
+    fprintf(fp, "%-32s %6s %10s %10s %10s %12s\n", "name", "hit%", "bytes", "matches", "ns/byte", "ns/match");
+}
+
+inline void print(FILE *fp, const Result &r) {
+    fprintf(fp, "%-32s %6.1f %10zu %10zu %10.3f %12.3f\n",
+            r.name.c_str(), r.hitRatio * 100.0, r.bytes, r.matches, r.nsPerByte(), r.nsPerMatch());
+}
+
+/**
+ * run func repeatedly until elapsed time exceeds minNs.
+ * @param func
+ * must return number of matches in one iteration
+ * @param minNs
+ * @return
+ * pair of (iteration, total ns)
+ */
+template <typename Func>
+inline std::pair<std::size_t, double> measure(Func func, std::size_t &matches, double minNs = 2e8) {
+    matches = func();    // warm up
+    std::size_t iteration = 0;
+    double total = 0;
+    for(std::size_t n = 1; total < minNs; n *= 2) {
+        auto start = Clock::now();
+        for(std::size_t i = 0; i < n; i++) {
+            doNotOptimize(func());
+        }
+        auto stop = Clock::now();
+        iteration += n;
+        total += elapsedNs(start, stop);
+    }
+    return {iteration, total};
+}
+
+/**
+ * filter benchmark by name (substring match). if filter is empty, match all.
+ */
+inline bool isTarget(const char *filter, const std::string &name) {
+    return filter == nullptr || *filter == '\0' || name.find(filter) != std::string::npos;
+}
+
+} // namespace bench
+
+#endif //AQUARIUS_CXX_BENCH_BENCH_HPP
@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+/**
+ * generate synthetic json corpus.
+ * output is determined only by (shape, size, seed, depth). std::mt19937_64 output is specified by the standard,
+ * and std distributions (implementation-defined) are not used.
+ *
+ * all of shapes generate a top-level array, so output can be parsed by every example grammar.
+ * escapes are limited to \" \\ \/ \b \f \n \r \t (\uXXXX is not supported by example grammars).
+ */
+
+class Writer {
+private:
+    FILE *fp_;
+    std::size_t size_{0};
+
+public:
+    explicit Writer(FILE *fp) : fp_(fp) { }
+
+    void put(char ch) {
+        fputc(ch, this->fp_);
+        this->size_++;
+    }
+
+    void put(const char *str, std::size_t size) {
+        fwrite(str, sizeof(char), size, this->fp_);
+        this->size_ += size;
+    }
+
+    void put(const char *str) {
+        this->put(str, strlen(str));
+    }
+
+    void put(const std::string &str) {
+        this->put(str.c_str(), str.size());
+    }
+
+    std::size_t size() const {
+        return this->size_;
+    }
+};
+
+enum class Shape : unsigned char {
+    NESTED,     // deeply nested arrays/objects
+    WIDE,       // one very wide array of small scalars
+    ESCAPE,     // long strings full of escapes
+    NUMBER,     // number-heavy arrays
+    PRETTY,     // pretty-printed objects (whitespace-heavy)
+    UTF8,       // strings of multi-byte utf-8 characters
+};
+
+static const struct {
+    const char *name;
+    Shape shape;
+} shapes[] = {
+        {"nested", Shape::NESTED},
+        {"wide",   Shape::WIDE},
+        {"escape", Shape::ESCAPE},
+        {"number", Shape::NUMBER},
+        {"pretty", Shape::PRETTY},
+        {"utf8",   Shape::UTF8},
+};
+
+class Generator {
+private:
+    Writer &writer_;
+
+    std::mt19937_64 engine_;
+
+    /**
+     * max nesting level of NESTED shape
+     */
+    unsigned int depth_;
+
+public:
+    Generator(Writer &writer, std::uint64_t seed, unsigned int depth) :
+            writer_(writer), engine_(seed), depth_(depth) { }
+
+    /**
+     * generate top-level array until output size reaches size
+     * @param shape
+     * @param size
+     */
+    void generate(Shape shape, std::size_t size) {
+        const bool pretty = shape == Shape::PRETTY;
+        this->writer_.put('[');
+        for(unsigned int count = 0; this->writer_.size() + 2 < size; count++) {
+            if(count > 0) {
+                this->writer_.put(',');
+            }
+            if(pretty) {
+                this->newline(1);
+            }
+            this->element(shape, size);
+        }
+        if(pretty) {
+            this->newline(0);
+        }
+        this->writer_.put(']');
+        this->writer_.put('\n');
+    }
+
+private:
+    /**
+     *
+     * @param n
+     * @return
+     * [0, n)
+     */
+    std::size_t next(std::size_t n) {
+        return static_cast<std::size_t>(this->engine_() % n);
+    }
+
+    void element(Shape shape, std::size_t size) {
+        // keep long element smaller than whole size
+        const std::size_t maxLen = std::max<std::size_t>(size / 8, 16);
+        switch(shape) {
+        case Shape::NESTED:
+            this->nested(0);
+            break;
+        case Shape::WIDE:
+            this->scalar();
+            break;
+        case Shape::ESCAPE:
+            this->escapedString(std::min<std::size_t>(this->next(4096) + 1, maxLen));
+            break;
+        case Shape::NUMBER:
+            this->writer_.put('[');
+            for(unsigned int i = 0, n = this->next(16) + 1; i < n; i++) {
+                if(i > 0) {
+                    this->writer_.put(',');
+                }
+                this->number();
+            }
+            this->writer_.put(']');
+            break;
+        case Shape::PRETTY:
+            this->pretty(1, 0);
+            break;
+        case Shape::UTF8:
+            this->utf8String(std::min<std::size_t>(this->next(1024) + 1, maxLen));
+            break;
+        }
+    }
+
+    void number() {
+        std::string str;
+        if(this->next(2) == 0) {
+            str += '-';
+        }
+        switch(this->next(4)) {
+        case 0:     // small integer
+            str += std::to_string(this->next(100));
+            break;
+        case 1:     // large integer
+            str += std::to_string(this->next(9) + 1);
+            for(unsigned int i = 0, n = this->next(17); i < n; i++) {
+                str += static_cast<char>('0' + this->next(10));
+            }
+            break;
+        default:    // fraction (and exponent)
+            str += std::to_string(this->next(100000));
+            str += '.';
+            for(unsigned int i = 0, n = this->next(15) + 1; i < n; i++) {
+                str += static_cast<char>('0' + this->next(10));
+            }
+            if(this->next(2) == 0) {
+                str += "eE"[this->next(2)];
+                if(this->next(2) == 0) {
+                    str += "+-"[this->next(2)];
+                }
+                str += std::to_string(this->next(300));
+            }
+            break;
+        }
+        this->writer_.put(str);
+    }
+
+    void shortString() {
+        static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_ ";
+        this->writer_.put('"');
+        for(unsigned int i = 0, n = this->next(16); i < n; i++) {
+            this->writer_.put(chars[this->next(sizeof(chars) - 1)]);
+        }
+        this->writer_.put('"');
+    }
+
+    void scalar() {
+        switch(this->next(6)) {
+        case 0:
+            this->writer_.put("true");
+            break;
+        case 1:
+            this->writer_.put("false");
+            break;
+        case 2:
+            this->writer_.put("null");
+            break;
+        case 3:
+        case 4:
+            this->number();
+            break;
+        default:
+            this->shortString();
+            break;
+        }
+    }
+
+    void key() {
+        this->shortString();
+        this->writer_.put(':');
+    }
+
+    /**
+     * first child is always nested until max depth
+     * @param level
+     */
+    void nested(unsigned int level) {
+        if(level >= this->depth_) {
+            this->scalar();
+            return;
+        }
+        const bool object = this->next(2) == 0;
+        this->writer_.put(object ? '{' : '[');
+        for(unsigned int i = 0, n = this->next(3) + 1; i < n; i++) {
+            if(i > 0) {
+                this->writer_.put(',');
+            }
+            if(object) {
+                this->key();
+            }
+            if(i == 0) {
+                this->nested(level + 1);
+            } else {
+                this->scalar();
+            }
+        }
+        this->writer_.put(object ? '}' : ']');
+    }
+
+    void escapedString(std::size_t len) {
+        static const char *escapes[] = {"\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t"};
+        this->writer_.put('"');
+        for(std::size_t i = 0; i < len; i++) {
+            if(this->next(2) == 0) {
+                this->writer_.put(escapes[this->next(8)]);
+            } else {
+                this->writer_.put(static_cast<char>('a' + this->next(26)));
+            }
+        }
+        this->writer_.put('"');
+    }
+
+    void putCodePoint(unsigned int code) {
+        char buf[4];
+        std::size_t size;
+        if(code < 0x80) {
+            buf[0] = static_cast<char>(code);
+            size = 1;
+        } else if(code < 0x800) {
+            buf[0] = static_cast<char>(0xC0 | (code >> 6));
+            buf[1] = static_cast<char>(0x80 | (code & 0x3F));
+            size = 2;
+        } else if(code < 0x10000) {
+            buf[0] = static_cast<char>(0xE0 | (code >> 12));
+            buf[1] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            buf[2] = static_cast<char>(0x80 | (code & 0x3F));
+            size = 3;
+        } else {
+            buf[0] = static_cast<char>(0xF0 | (code >> 18));
+            buf[1] = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            buf[2] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            buf[3] = static_cast<char>(0x80 | (code & 0x3F));
+            size = 4;
+        }
+        this->writer_.put(buf, size);
+    }
+
+    /**
+     * mix of 1 to 4 byte characters (no surrogate, no control character)
+     * @param len
+     * number of characters
+     */
+    void utf8String(std::size_t len) {
+        this->writer_.put('"');
+        for(std::size_t i = 0; i < len; i++) {
+            switch(this->next(4)) {
+            case 0:
+                this->putCodePoint(static_cast<unsigned int>('a' + this->next(26)));
+                break;
+            case 1:
+                this->putCodePoint(static_cast<unsigned int>(0xC0 + this->next(0x800 - 0xC0)));  // latin, greek, ...
+                break;
+            case 2:
+                this->putCodePoint(static_cast<unsigned int>(0x3041 + this->next(0x9FFF - 0x3041)));  // kana, kanji
+                break;
+            default:
+                this->putCodePoint(static_cast<unsigned int>(0x1F300 + this->next(0x1F600 - 0x1F300)));  // emoji
+                break;
+            }
+        }
+        this->writer_.put('"');
+    }
+
+    void newline(unsigned int indent) {
+        this->writer_.put('\n');
+        for(unsigned int i = 0; i < indent; i++) {
+            this->writer_.put("    ");
+        }
+    }
+
+    void pretty(unsigned int indent, unsigned int level) {
+        if(level >= 3) {
+            this->scalar();
+            return;
+        }
+        const bool object = this->next(3) != 0;
+        const unsigned int n = this->next(5) + 1;
+        this->writer_.put(object ? '{' : '[');
+        for(unsigned int i = 0; i < n; i++) {
+            if(i > 0) {
+                this->writer_.put(',');
+            }
+            this->newline(indent + 1);
+            if(object) {
+                this->shortString();
+                this->writer_.put(" : ");
+            }
+            if(this->next(3) == 0) {
+                this->pretty(indent + 1, level + 1);
+            } else {
+                this->scalar();
+            }
+        }
+        this->newline(indent);
+        this->writer_.put(object ? '}' : ']');
+    }
+};
+
+/**
+ * parse size with unit suffix (K, M, G)
+ * @param str
+ * @return
+ * if invalid format, return 0
+ */
+static std::size_t parseSize(const char *str) {
+    char *end;
+    unsigned long long size = std::strtoull(str, &end, 10);
+    switch(*end) {
+    case 'k':
+    case 'K':
+        size <<= 10u;
+        end++;
+        break;
+    case 'm':
+    case 'M':
+        size <<= 20u;
+        end++;
+        break;
+    case 'g':
+    case 'G':
+        size <<= 30u;
+        end++;
+        break;
+    default:
+        break;
+    }
+    return *end == '\0' ? static_cast<std::size_t>(size) : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "[usage] %s [--size N[K|M|G]] [--seed N] [--depth N] [-o file] shape\n", prog);
+    fprintf(stderr, "    shape: ");
+    for(auto &e : shapes) {
+        fprintf(stderr, "%s ", e.name);
+    }
+    fputc('\n', stderr);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    std::size_t size = 1024 * 1024;
+    std::uint64_t seed = 42;
+    unsigned int depth = 64;
+    const char *output = nullptr;
+    const char *shapeName = nullptr;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = parseSize(argv[++i]);
+        } else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if(argv[i][0] == '-' || shapeName != nullptr) {
+            usage(argv[0]);
+        } else {
+            shapeName = argv[i];
+        }
+    }
+
+    const Shape *shape = nullptr;
+    for(auto &e : shapes) {
+        if(shapeName != nullptr && strcmp(shapeName, e.name) == 0) {
+            shape = &e.shape;
+        }
+    }
+    if(shape == nullptr || size == 0) {
+        usage(argv[0]);
+    }
+
+    FILE *fp = output == nullptr ? stdout : fopen(output, "wb");
+    if(fp == nullptr) {
+        fprintf(stderr, "cannot open file: %s\n", output);
+        return 1;
+    }
+    static char buf[1024 * 1024];
+    setvbuf(fp, buf, _IOFBF, sizeof(buf));
+
+    Writer writer(fp);
+    Generator(writer, seed, depth).generate(*shape, size);
+
+    bool s = fflush(fp) == 0 && ferror(fp) == 0;
+    if(output != nullptr) {
+        s = fclose(fp) == 0 && s;
+    }
+    if(!s) {
+        fprintf(stderr, "write error\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+#include "../example/json2/json_parser.hpp"
+
+#include "bench.hpp"
+#include "json_bench.hpp"
+
+bool parseJson2(const char *begin, const char *end) {
+    auto result = aquarius::Parser<json2::json>()(begin, end);
+    bench::doNotOptimize(result);
+    return static_cast<bool>(result);
+}
@@ -0,0 +1,10 @@
+#include "../example/json3/json_parser.hpp"
+
+#include "bench.hpp"
+#include "json_bench.hpp"
+
+bool parseJson3(const char *begin, const char *end) {
+    auto result = aquarius::Parser<json3::json>()(begin, end);
+    bench::doNotOptimize(result);
+    return static_cast<bool>(result);
+}
@@ -0,0 +1,13 @@
+#include "../example/json4/json_parser.hpp"
+
+#include "bench.hpp"
+#include "json_bench.hpp"
+
+bool parseJson4(const char *begin, const char *end) {
+    // reuse memory blocks across documents. values are destroyed by clear() (same as destruction of tree)
+    static aquarius::Arena arena;
+    auto result = aquarius::Parser<json4::json>()(begin, end, arena);
+    bench::doNotOptimize(result);
+    arena.clear();
+    return static_cast<bool>(result);
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#include <sys/resource.h>
+
+#include <aquarius.hpp>
+
+#include "bench.hpp"
+#include "json_bench.hpp"
+
+// count heap allocation of whole process
+static std::size_t allocCount = 0;
+static std::size_t allocBytes = 0;
+
+void *operator new(std::size_t size) {
+    allocCount++;
+    allocBytes += size;
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr) {
+        std::abort();
+    }
+    return ptr;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+/**
+ *
+ * @return
+ * peak resident set size of process in KB
+ */
+static long peakRSS() {
+    struct rusage usage; //NOLINT
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+struct Grammar {
+    const char *name;
+    ParseFunc func;
+};
+
+static const Grammar grammars[] = {
+        {"json",  parseJson},
+        {"json2", parseJson2},
+        {"json3", parseJson3},
+        {"json4", parseJson4},
+};
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/**
+ * parse each document of corpus in order, iteration times.
+ */
+static bool run(const Grammar &grammar, const std::vector<aquarius::InputFile> &corpus, std::size_t iteration) {
+    std::size_t corpusBytes = 0;
+    for(auto &doc : corpus) {
+        corpusBytes += doc.size();
+    }
+
+    // warm up and check result
+    for(auto &doc : corpus) {
+        if(!grammar.func(doc.begin(), doc.end())) {
+            fprintf(stderr, "%s: parse error\n", grammar.name);
+            return false;
+        }
+    }
+
+    std::vector<double> latency;
+    latency.reserve(corpus.size() * iteration);
+    const std::size_t oldCount = allocCount;
+    const std::size_t oldBytes = allocBytes;
+    double total = 0;
+    for(std::size_t i = 0; i < iteration; i++) {
+        for(auto &doc : corpus) {
+            auto start = bench::Clock::now();
+            grammar.func(doc.begin(), doc.end());
+            auto stop = bench::Clock::now();
+            double ns = bench::elapsedNs(start, stop);
+            latency.push_back(ns);
+            total += ns;
+        }
+    }
+    const auto docs = static_cast<double>(corpus.size() * iteration);
+    const double allocs = static_cast<double>(allocCount - oldCount) / docs;
+    const double bytes = static_cast<double>(allocBytes - oldBytes) / docs;
+
+    std::sort(latency.begin(), latency.end());
+    printf("%-8s %10.1f %12.1f %12.1f %12.1f %12.1f %14.1f %10ld\n", grammar.name,
+           static_cast<double>(corpusBytes * iteration) / (total / 1e9) / (1024 * 1024),
+           percentile(latency, 0.5) / 1e3, percentile(latency, 0.99) / 1e3, percentile(latency, 0.999) / 1e3,
+           allocs, bytes, peakRSS());
+    return true;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "[usage] %s [--iter N] [--grammar name] [json file ...]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    std::size_t iteration = 10;
+    const char *filter = nullptr;
+    std::vector<aquarius::InputFile> corpus;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--iter") == 0 && i + 1 < argc) {
+            iteration = std::strtoull(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "--grammar") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if(argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            aquarius::InputFile file;
+            if(!file.open(argv[i])) {
+                fprintf(stderr, "cannot open file: %s\n", argv[i]);
+                return 1;
+            }
+            corpus.push_back(std::move(file));
+        }
+    }
+    if(corpus.empty() || iteration == 0) {
+        usage(argv[0]);
+    }
+
+    // peak RSS is maximum of whole process. to measure each grammar separately, specify --grammar
+    printf("%-8s %10s %12s %12s %12s %12s %14s %10s\n", "grammar", "MB/s",
+           "p50[us]", "p99[us]", "p999[us]", "allocs/doc", "alloc-B/doc", "RSS[KB]");
+    for(auto &grammar : grammars) {
+        if(bench::isTarget(filter, grammar.name) && !run(grammar, corpus, iteration)) {
+            return 1;
+        }
+    }
+    return 0;
+}
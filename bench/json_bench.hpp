@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_BENCH_JSON_BENCH_HPP
+#define AQUARIUS_CXX_BENCH_JSON_BENCH_HPP
+
+/**
+ * parse one document and destroy its result.
+ * each example grammar is defined in its own namespace (json, json2, json3, json4) and compiled in its own translation unit.
+ * @return
+ * if parse failed, return false
+ */
+using ParseFunc = bool (*)(const char *begin, const char *end);
+
+bool parseJson(const char *begin, const char *end);     // example/json (recognizer)
+bool parseJson2(const char *begin, const char *end);    // example/json2 (std::unique_ptr DOM)
+bool parseJson3(const char *begin, const char *end);    // example/json3 (value DOM)
+bool parseJson4(const char *begin, const char *end);    // example/json4 (arena DOM)
+
+#endif //AQUARIUS_CXX_BENCH_JSON_BENCH_HPP
@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <aquarius.hpp>
+
+#include "../example/json3/json_parser.hpp"
+
+// parse json files by example/json3 with SamplingPolicy (or ProfilePolicy),
+// and print collapsed stacks of rules (or profile table) to stdout.
+//
+// ex. json_flame corpus/nested.json | flamegraph.pl > nested.svg
+
+static void usage(const char *prog) {
+    fprintf(stderr, "[usage] %s [--period N] [--iter N] [--profile | --tsv] [json file ...]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    std::uint32_t period = 1;
+    std::size_t iteration = 1;
+    const char *format = nullptr;
+    std::vector<aquarius::InputFile> corpus;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+            period = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if(strcmp(argv[i], "--iter") == 0 && i + 1 < argc) {
+            iteration = std::strtoull(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "--profile") == 0 || strcmp(argv[i], "--tsv") == 0) {
+            format = argv[i];
+        } else if(argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            aquarius::InputFile file;
+            if(!file.open(argv[i])) {
+                fprintf(stderr, "cannot open file: %s\n", argv[i]);
+                return 1;
+            }
+            corpus.push_back(std::move(file));
+        }
+    }
+    if(corpus.empty()) {
+        usage(argv[0]);
+    }
+
+    aquarius::CallTree tree;
+    for(std::size_t count = 0; count < iteration; count++) {
+        for(auto &doc : corpus) {
+            bool s;
+            if(format != nullptr) {
+                auto state = aquarius::createState<aquarius::ProfilePolicy>(doc.begin(), doc.end());
+                s = static_cast<bool>(aquarius::Parser<json3::json>()(state));
+            } else {
+                auto state = aquarius::createState<aquarius::SamplingPolicy>(doc.begin(), doc.end());
+                state.policy().setPeriod(period);
+                s = static_cast<bool>(aquarius::Parser<json3::json>()(state));
+                tree.merge(state.policy().callTree());
+            }
+            if(!s) {
+                fprintf(stderr, "parse error\n");
+                return 1;
+            }
+        }
+    }
+
+    std::string out;
+    if(format == nullptr) {
+        out = tree.toCollapsed();
+    } else {
+        auto profile = aquarius::ProfileRegistry::instance().collect();
+        out = strcmp(format, "--tsv") == 0 ? profile.toTSV() : profile.toTable();
+    }
+    fwrite(out.data(), 1, out.size(), stdout);
+    return 0;
+}
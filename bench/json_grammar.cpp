@@ -0,0 +1,10 @@
+#include "../example/json/simple_json_parser.hpp"
+
+#include "bench.hpp"
+#include "json_bench.hpp"
+
+bool parseJson(const char *begin, const char *end) {
+    auto result = aquarius::Parser<json::json>()(begin, end);
+    bench::doNotOptimize(result);
+    return static_cast<bool>(result);
+}
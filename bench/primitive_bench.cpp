@@ -0,0 +1,201 @@
+#include <cstdlib>
+
+#include <aquarius.hpp>
+
+#include "bench.hpp"
+
+using namespace aquarius;
+
+struct ToInt {
+    int operator()(std::string &&str) const {
+        return std::atoi(str.c_str());
+    }
+};
+
+template <typename P, typename Iterator,
+        misc::enable_when<std::is_void<typename P::retType>::value> = nullptr>
+inline void invoke(const P &p, ParserState<Iterator> &state) {
+    p(state);
+}
+
+template <typename P, typename Iterator,
+        misc::enable_when<!std::is_void<typename P::retType>::value> = nullptr>
+inline void invoke(const P &p, ParserState<Iterator> &state) {
+    auto v = p(state);
+    bench::doNotOptimize(v);
+}
+
+/**
+ * apply expression from each position of input. if not matched (or matched empty), skip one byte.
+ * @param p
+ * @param input
+ * @return
+ * number of matches
+ */
+template <typename P>
+std::size_t scan(const P &p, std::string &input) {
+    std::size_t matches = 0;
+    auto state = createState(&input[0], &input[0] + input.size());
+    while(state.cursor() != state.end()) {
+        auto old = state.cursor();
+        state.setResult(true);
+        invoke(p, state);
+        if(state.result() && state.cursor() != old) {
+            matches++;
+        } else {
+            state.cursor() = old + 1;
+        }
+    }
+    return matches;
+}
+
+struct Config {
+    std::size_t size{1024 * 1024};
+    double minNs{5e7};
+    const char *filter{nullptr};
+};
+
+template <typename P, typename Hit, typename Miss>
+void run(const Config &config, const char *name, const P &p, Hit hit, Miss miss) {
+    if(!bench::isTarget(config.filter, name)) {
+        return;
+    }
+    for(double ratio : {0.1, 0.5, 0.9}) {
+        auto input = bench::generate(config.size, ratio, hit, miss);
+        bench::Result r;
+        r.name = name;
+        r.hitRatio = ratio;
+        r.bytes = input.size();
+        auto pair = bench::measure([&] { return scan(p, input); }, r.matches, config.minNs);
+        r.iteration = pair.first;
+        r.totalNs = pair.second;
+        bench::print(stdout, r);
+    }
+}
+
+/**
+ * return fixed token
+ */
+struct Token {
+    const char *str;
+
+    std::string operator()(std::mt19937 &) const {
+        return this->str;
+    }
+};
+
+/**
+ * return one of tokens
+ */
+struct OneOf {
+    std::vector<std::string> tokens;
+
+    OneOf(std::initializer_list<const char *> list) : tokens(list.begin(), list.end()) { }
+
+    std::string operator()(std::mt19937 &engine) const {
+        return this->tokens[engine() % this->tokens.size()];
+    }
+};
+
+/**
+ * return run of characters (1 - maxLen)
+ */
+struct Run {
+    const char *chars;
+    std::size_t maxLen;
+
+    std::string operator()(std::mt19937 &engine) const {
+        std::size_t len = engine() % this->maxLen + 1;
+        std::size_t n = strlen(this->chars);
+        std::string str;
+        for(std::size_t i = 0; i < len; i++) {
+            str += this->chars[engine() % n];
+        }
+        return str;
+    }
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr, "[usage] %s [--size bytes] [--time ms] [filter]\n", prog);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    Config config;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            config.size = std::strtoull(argv[++i], nullptr, 10);
+        } else if(strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            config.minNs = std::strtod(argv[++i], nullptr) * 1e6;
+        } else if(argv[i][0] == '-') {
+            usage(argv[0]);
+        } else {
+            config.filter = argv[i];
+        }
+    }
+
+    bench::printHeader(stdout);
+
+    // primitive
+    run(config, "Any", ascii::ANY, Run{"abcxyz012", 1}, Token{"\xE3"});
+    run(config, "Utf8Any", unicode::ANY, OneOf{"\xE3\x81\x82", "a", "\xC3\xA9"}, Token{"\xFF"});
+    run(config, "StringLiteral", ascii::str("while"), Token{"while"}, OneOf{"whilx", "x", "wh"});
+    run(config, "StringLiteral/long", ascii::str("0123456789abcdefghijklmnopqrstuvwxyz"),
+        Token{"0123456789abcdefghijklmnopqrstuvwxyz"}, Token{"0123456789abcdefghijklmnopqrstuvwxyZ"});
+    run(config, "Char", ch('a'), Token{"a"}, Token{"b"});
+    run(config, "Utf8Char", unicode::ch(U'あ'), Token{"あ"}, Token{"い"});
+    run(config, "CharClass", set("a-zA-Z_"), Run{"abcXYZ_", 1}, Run{"0123", 1});
+    run(config, "Utf8CharClass", unicode::set(U"あ-んa-z"), OneOf{"か", "q"}, OneOf{"ア", "0"});
+
+    // repetition
+    run(config, "RepeatVoid/CharClass", *set(" \t\r\n"), Run{" \t\r\n", 32}, Token{"x"});
+    run(config, "RepeatVoid/Char", +ch('a'), Run{"a", 32}, Token{"b"});
+    run(config, "RepeatVoid/delim", repeat<1>(set("0-9"), ch(',')), Run{"0,1,2,", 16}, Token{"x"});
+    run(config, "RepeatFixed", repeat<4, 4>(set("0-9a-fA-F")), Token{"12aF"}, OneOf{"12x4", "12a"});
+    run(config, "Repeat", +text[ set("0-9") ], Run{"0123456789", 16}, Token{"x"});
+
+    // option, predicate
+    run(config, "OptionVoid", -ascii::str("let") >> ch(' '), OneOf{"let ", " "}, Token{"x"});
+    run(config, "Option", -text[ ascii::str("let") ] >> ch(' '), OneOf{"let ", " "}, Token{"x"});
+    run(config, "NotPredicate", !set("\"\\") >> ascii::ANY, Run{"abc xyz", 1}, OneOf{"\"", "\\"});
+    run(config, "SkipUntil", ch('"') >> skip_until("\"\\") >> ch('"'),
+        OneOf{"\"\"", "\"abc xyz\"", "\"0123456789abcdefghijklmnopqrstuvwxyz 0123456789abcdefghijklmnopqrstuvwxyz\""},
+        Token{"x"});
+    run(config, "SkipUntil/idiom", ch('"') >> *(!set("\"\\") >> ascii::ANY) >> ch('"'),
+        OneOf{"\"\"", "\"abc xyz\"", "\"0123456789abcdefghijklmnopqrstuvwxyz 0123456789abcdefghijklmnopqrstuvwxyz\""},
+        Token{"x"});
+
+    // capture
+    run(config, "Capture", text[ +set("a-z") ], Run{"abcxyz", 16}, Token{"0"});
+    run(config, "ViewCapture", view[ +set("a-z") ], Run{"abcxyz", 16}, Token{"0"});
+
+    // sequence
+    run(config, "SequenceVoid", ch('a') >> ch('b') >> ch('c'), Token{"abc"}, OneOf{"abx", "x"});
+    run(config, "SequenceLeftVoid", ch('a') >> text[ ch('b') ], Token{"ab"}, OneOf{"ax", "x"});
+    run(config, "SequenceRightVoid", text[ ch('a') ] >> ch('b'), Token{"ab"}, OneOf{"ax", "x"});
+    run(config, "Sequence", text[ ch('a') ] >> text[ ch('b') ] >> text[ ch('c') ],
+        Token{"abc"}, OneOf{"abx", "x"});
+    constexpr auto hex = set("0-9a-f");
+    run(config, "SequenceFixed", repeat<8, 8>(hex) >> ch('-') >> repeat<4, 4>(hex) >> ch('-') >> repeat<4, 4>(hex) >>
+                                 ch('-') >> repeat<4, 4>(hex) >> ch('-') >> repeat<12, 12>(hex),
+        Token{"123e4567-e89b-12d3-a456-426614174000"}, OneOf{"123e4567-e89b-12d3-x456-426614174000", "123e4567"});
+
+    // choice
+    run(config, "ChoiceVoid", ascii::str("true") | ascii::str("false") | ascii::str("null"),
+        OneOf{"true", "false", "null"}, OneOf{"nul", "x"});
+    run(config, "Choice", text[ ascii::str("true") ] | text[ ascii::str("false") ] | text[ ascii::str("null") ],
+        OneOf{"true", "false", "null"}, OneOf{"nul", "x"});
+    run(config, "ChoiceVoid/prefix", -ch('-') >> (ch('0') | set("1-9") >> *set("0-9")) >> ch('.') >> +set("0-9")
+                                     | -ch('-') >> (ch('0') | set("1-9") >> *set("0-9")),
+        OneOf{"-1234567", "1234.5678", "0"}, OneOf{"-", "x"});
+
+    // automaton
+    constexpr auto alt = *(ch('a') >> ch('b') | ch('c') | ch('d') >> -ch('e'));
+    run(config, "Regular/original", alt, OneOf{"ab", "c", "d", "de"}, Token{"x"});
+    run(config, "Regular", dfa[ alt ], OneOf{"ab", "c", "d", "de"}, Token{"x"});
+
+    // mapper
+    run(config, "MapperAdapter", text[ +set("0-9") ] >> map<ToInt>(), Run{"0123456789", 8}, Token{"x"});
+
+    return 0;
+}
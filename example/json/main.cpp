@@ -1,6 +1,5 @@
 #include <cstdio>
 #include <iostream>
-#include <fstream>
 #include <chrono>
 
 #include "simple_json_parser.hpp"
@@ -11,19 +10,12 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    std::string input;
-    std::string line;
-    std::ifstream stream(argv[1]);
-
-    if(!stream) {
-        fprintf(stderr, "cannot open file: %s\n", argv[0]);
+    aquarius::InputFile input;
+    if(!input.open(argv[1])) {
+        fprintf(stderr, "cannot open file: %s\n", argv[1]);
         return 1;
     }
 
-    while(std::getline(stream, line)) {
-        input += line;
-    }
-
     auto start = std::chrono::system_clock::now();
 
     auto p = aquarius::Parser<json::json>()(input.begin(), input.end());
@@ -31,7 +23,9 @@ int main(int argc, char **argv) {
     auto stop = std::chrono::system_clock::now();
 
     if(!static_cast<bool>(p)) {
-        fprintf(stderr, "parse error\n%s\n", input.c_str());
+        fprintf(stderr, "parse error\n");
+        fwrite(input.data(), sizeof(char), input.size(), stderr);
+        fputc('\n', stderr);
 
         return 1;
     }
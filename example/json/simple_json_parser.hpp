@@ -36,7 +36,7 @@ constexpr auto kvSep = space >> ch(':') >> space;
 constexpr auto vSep = ch(',') >> space;
 
 constexpr auto escape = ch('\\') >> set("\"\\/bfnrt");
-constexpr auto string = ch('"') >> *(escape | !set("\"\\") >> ANY) >> ch('"');
+constexpr auto string = ch('"') >> skip_until("\"\\") >> *(escape >> skip_until("\"\\")) >> ch('"');
 
 constexpr auto integer = ch('0') | set("1-9") >> *set("0-9");
 constexpr auto exp = set("eE") >> -set("+-") >> integer;
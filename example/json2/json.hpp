@@ -23,7 +23,7 @@
 #include <functional>
 #include <memory>
 
-namespace json {
+namespace json2 {
 
 enum class JSONKind {
     NIL,
@@ -161,6 +161,6 @@ public:
 
 
 
-} // namespace json
+} // namespace json2
 
 #endif //AQUARIUS_CXX_JSON2_JSON_H
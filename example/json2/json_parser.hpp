@@ -23,7 +23,7 @@
 
 #include "json.hpp"
 
-namespace json {
+namespace json2 {
 
 struct ToNumber {
     std::unique_ptr<JSONNumber> operator()(std::string &&str) const {
@@ -60,7 +60,7 @@ constexpr auto kvSep = space >> ch(':') >> space;
 constexpr auto vSep = ch(',') >> space;
 
 constexpr auto escape = ch('\\') >> set("\"\\/bfnrt");
-constexpr auto string = text[ ch('"') >> *(escape | !set("\"\\") >> ANY) >> ch('"') ] >> construct<JSONString *>();
+constexpr auto string = text[ ch('"') >> skip_until("\"\\") >> *(escape >> skip_until("\"\\")) >> ch('"') ] >> construct<JSONString *>();
 
 constexpr auto integer = ch('0') | set("1-9") >> *set("0-9");
 constexpr auto exp = set("eE") >> -set("+-") >> integer;
@@ -97,7 +97,7 @@ AQ_DEFINE_RULE(json, std::unique_ptr<JSON>) {
     return space >> (nterm<object>() >> cast<JSON>() | nterm<array>());
 }
 
-} // namespace json
+} // namespace json2
 
 
 #endif //AQUARIUS_CXX_JSON2_JSON_PARSER_HPP
@@ -23,7 +23,7 @@
 #include <stdexcept>
 #include <cassert>
 
-namespace json {
+namespace json3 {
 
 class JSON;
 
@@ -154,6 +154,6 @@ public:
 };
 
 
-} // namespace json
+} // namespace json3
 
 #endif //AQUARIUS_CXX_JSON3_JSON_HPP
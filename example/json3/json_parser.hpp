@@ -21,7 +21,7 @@
 
 #include "json.hpp"
 
-namespace json {
+namespace json3 {
 
 struct ToNumber {
     JSON operator()(std::string &&str) const {
@@ -56,7 +56,7 @@ constexpr auto kvSep = space >> ch(':') >> space;
 constexpr auto vSep = ch(',') >> space;
 
 constexpr auto escape = ch('\\') >> set("\"\\/bfnrt");
-constexpr auto string = text[ ch('"') >> *(escape | !set("\"\\") >> ANY) >> ch('"') ];
+constexpr auto string = text[ ch('"') >> skip_until("\"\\") >> *(escape >> skip_until("\"\\")) >> ch('"') ];
 
 constexpr auto integer = ch('0') | set("1-9") >> *set("0-9");
 constexpr auto exp = set("eE") >> -set("+-") >> integer;
@@ -92,7 +92,7 @@ AQ_DEFINE_RULE(json, JSON) {
     return space >> (nterm<object>() | nterm<array>());
 }
 
-} // namespace json
+} // namespace json3
 
 
 #endif //AQUARIUS_CXX_JSON3_JSON_PARSER_HPP
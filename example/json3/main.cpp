@@ -1,5 +1,4 @@
 #include <cstdio>
-#include <fstream>
 #include <iostream>
 #include <chrono>
 
@@ -11,27 +10,22 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    std::string input;
-    std::string line;
-    std::ifstream stream(argv[1]);
-
-    if(!stream) {
-        fprintf(stderr, "cannot open file: %s\n", argv[0]);
+    aquarius::InputFile input;
+    if(!input.open(argv[1])) {
+        fprintf(stderr, "cannot open file: %s\n", argv[1]);
         return 1;
     }
 
-    while(std::getline(stream, line)) {
-        input += line;
-    }
-
     auto start = std::chrono::system_clock::now();
 
-    auto p = aquarius::Parser<json::json>()(input.begin(), input.end());
+    auto p = aquarius::Parser<json3::json>()(input.begin(), input.end());
 
     auto stop = std::chrono::system_clock::now();
 
     if(!static_cast<bool>(p)) {
-        fprintf(stderr, "parse error\n%s\n", input.c_str());
+        fprintf(stderr, "parse error\n");
+        fwrite(input.data(), sizeof(char), input.size(), stderr);
+        fputc('\n', stderr);
 
         return 1;
     }
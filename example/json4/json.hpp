@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_JSON4_JSON_H
+#define AQUARIUS_CXX_JSON4_JSON_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <functional>
+
+#include <aquarius.hpp>
+
+// same as example/json2, but values are allocated in aquarius::Arena instead of heap
+namespace json4 {
+
+enum class JSONKind {
+    NIL,
+    BOOL,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT,
+};
+
+class JSON {
+private:
+    JSONKind kind_;
+
+protected:
+    explicit JSON(JSONKind kind) : kind_(kind) { }
+
+public:
+    virtual ~JSON() = default;
+
+    JSONKind kind() const {
+        return this->kind_;
+    }
+
+    bool is(JSONKind kind) const {
+        return this->kind_ == kind;
+    }
+};
+
+class JSONNull : public JSON {
+public:
+    JSONNull() : JSON(JSONKind::NIL) {}
+    ~JSONNull() override = default;
+};
+
+class JSONBool : public JSON {
+private:
+    bool value_;
+
+public:
+    JSONBool(bool value) : JSON(JSONKind::BOOL), value_(value) { }  //NOLINT
+
+    ~JSONBool() override = default;
+
+    bool value() const {
+        return this->value_;
+    }
+};
+
+class JSONString : public JSON {
+private:
+    std::string value_;
+
+public:
+    JSONString(std::string &&value) :   //NOLINT
+            JSON(JSONKind::STRING), value_(std::move(value)) { }
+
+    ~JSONString() override = default;
+
+    const std::string &value() const {
+        return this->value_;
+    }
+};
+
+class JSONNumber : public JSON {
+private:
+    double value_;
+
+public:
+    JSONNumber(double value) :  //NOLINT
+            JSON(JSONKind::NUMBER), value_(value) { }
+
+    ~JSONNumber() override = default;
+
+    double value() const {
+        return this->value_;
+    }
+};
+
+class JSONArray : public JSON {
+private:
+    std::vector<aquarius::ArenaPtr<JSON>> values_;
+
+public:
+    JSONArray() : JSON(JSONKind::ARRAY), values_() { }
+
+    ~JSONArray() override = default;
+
+    std::vector<aquarius::ArenaPtr<JSON>> &value() {
+        return this->values_;
+    }
+
+    const std::vector<aquarius::ArenaPtr<JSON>> &value() const {
+        return this->values_;
+    }
+};
+
+struct KeyComparator {
+    bool operator()(const aquarius::ArenaPtr<JSONString> &x, const aquarius::ArenaPtr<JSONString> &y) const {
+        return x->value() == y->value();
+    }
+};
+
+struct Hash {
+    std::size_t operator()(const aquarius::ArenaPtr<JSONString> &x) const {
+        return std::hash<std::string>()(x->value());
+    }
+};
+
+class JSONObject : public JSON {
+public:
+    using map_type = std::unordered_map<aquarius::ArenaPtr<JSONString>, aquarius::ArenaPtr<JSON>, Hash, KeyComparator>;
+
+private:
+    map_type values_;
+
+public:
+    JSONObject() : JSON(JSONKind::OBJECT), values_() { }
+
+    ~JSONObject() override = default;
+
+    map_type &value() {
+        return this->values_;
+    }
+
+    const map_type  &value() const {
+        return this->values_;
+    }
+};
+
+
+
+} // namespace json4
+
+#endif //AQUARIUS_CXX_JSON4_JSON_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_JSON4_JSON_PARSER_HPP
+#define AQUARIUS_CXX_JSON4_JSON_PARSER_HPP
+
+#include <cmath>
+
+#include <aquarius.hpp>
+
+#include "json.hpp"
+
+namespace json4 {
+
+struct ToNumber {
+    double operator()(std::string &&str) const {
+        return std::stod(str);
+    }
+};
+
+struct AppendToObject {
+    void operator()(aquarius::ArenaPtr<JSONObject> &json,
+                    aquarius::ArenaPtr<JSONString> &&l, aquarius::ArenaPtr<JSON> &&r) const {
+        json->value().insert(std::make_pair(std::move(l), std::move(r)));
+    }
+};
+
+struct AppendToArray {
+    void operator()(aquarius::ArenaPtr<JSONArray> &array, aquarius::ArenaPtr<JSON> &&v) const {
+        array->value().push_back(std::move(v));
+    }
+};
+
+
+using namespace aquarius;
+using namespace aquarius::ascii;
+
+constexpr auto space = *set(" \t\r\n");
+
+constexpr auto objectOpen = ch('{') >> space;
+constexpr auto objectClose = ch('}') >> space;
+
+constexpr auto arrayOpen = ch('[') >> space;
+constexpr auto arrayClose = ch(']') >> space;
+
+constexpr auto kvSep = space >> ch(':') >> space;
+constexpr auto vSep = ch(',') >> space;
+
+constexpr auto escape = ch('\\') >> set("\"\\/bfnrt");
+constexpr auto string = text[ ch('"') >> skip_until("\"\\") >> *(escape >> skip_until("\"\\")) >> ch('"') ] >> allocate<JSONString>();
+
+constexpr auto integer = ch('0') | set("1-9") >> *set("0-9");
+constexpr auto exp = set("eE") >> -set("+-") >> integer;
+constexpr auto number = text[ -ch('-') >> integer >> ch('.') >> +set("0-9") >> -exp
+                                | -ch('-') >> integer ] >> map<ToNumber>() >> allocate<JSONNumber>();
+
+AQ_DECL_RULE(object, ArenaPtr<JSONObject>);
+AQ_DECL_RULE(array, ArenaPtr<JSONArray>);
+
+AQ_DEFINE_RULE(value, ArenaPtr<JSON>) {
+    return (string >> cast<ArenaPtr<JSON>>()
+            | number
+            | nterm<object>()
+            | nterm<array>()
+            | str("true") >> supply(true) >> allocate<JSONBool>()
+            | str("false") >> supply(false) >> allocate<JSONBool>()
+            | str("null") >> allocate<JSONNull>()
+            ) >> space;
+}
+
+constexpr auto keyValue = string >> kvSep >> nterm<value>() >> space;
+
+AQ_DEFINE_RULE(array, ArenaPtr<JSONArray>) {
+    return arrayOpen >> allocate<JSONArray>() >>
+              join_each0<AppendToArray>(nterm<value>(), vSep) >> arrayClose;
+}
+
+AQ_DEFINE_RULE(object, ArenaPtr<JSONObject>) {
+    return objectOpen >> allocate<JSONObject>() >>
+               join_each0<AppendToObject>(keyValue, vSep) >> objectClose;
+}
+
+AQ_DEFINE_RULE(json, ArenaPtr<JSON>) {
+    return space >> (nterm<object>() >> cast<ArenaPtr<JSON>>() | nterm<array>());
+}
+
+} // namespace json4
+
+
+#endif //AQUARIUS_CXX_JSON4_JSON_PARSER_HPP
@@ -0,0 +1,43 @@
+#include <cstdio>
+#include <iostream>
+#include <chrono>
+
+#include "json_parser.hpp"
+
+int main(int argc, char **argv) {
+    if(argc != 2) {
+        fprintf(stderr, "[usage] %s [json file]\n", argv[0]);
+        return 1;
+    }
+
+    aquarius::InputFile input;
+    if(!input.open(argv[1])) {
+        fprintf(stderr, "cannot open file: %s\n", argv[1]);
+        return 1;
+    }
+
+    // all of JSON values are allocated in arena and freed at once
+    aquarius::Arena arena;
+
+    auto start = std::chrono::system_clock::now();
+
+    auto p = aquarius::Parser<json4::json>()(input.begin(), input.end(), arena);
+
+    auto stop = std::chrono::system_clock::now();
+
+    if(!static_cast<bool>(p)) {
+        fprintf(stderr, "parse error\n");
+        fwrite(input.data(), sizeof(char), input.size(), stderr);
+        fputc('\n', stderr);
+
+        return 1;
+    }
+
+    auto interval = stop - start;
+    std::cout << "time:" <<
+    std::chrono::duration_cast<std::chrono::milliseconds>(interval).count() << "[ms]" << std::endl;
+
+    return 0;
+}
+
+
@@ -21,6 +21,9 @@
 #include "internal/mapper.hpp"
 #include "internal/parser.hpp"
 #include "internal/combinator.hpp"
+#include "internal/stream.hpp"
+#include "internal/file.hpp"
+#include "internal/profile.hpp"
 
 // helper macro
 #define aquarius_pattern_t constexpr auto
@@ -29,6 +32,20 @@
 template <typename T>             \
 struct name ## __impl {           \
     static constexpr auto pattern();                                  \
+    static constexpr const char *ruleName() { return #name; }        \
+}; using name = name ## __impl<__VA_ARGS__>;  \
+template<typename T> constexpr auto name ## __impl<T>::pattern()
+
+/**
+ * same as AQ_DEFINE_RULE, but results of rule application are memoized per input position.
+ * memoized rule must be void type.
+ */
+#define AQ_DEFINE_MEMO_RULE(name, ...) \
+template <typename T>             \
+struct name ## __impl {           \
+    static constexpr bool memoize = true;                             \
+    static constexpr auto pattern();                                  \
+    static constexpr const char *ruleName() { return #name; }        \
 }; using name = name ## __impl<__VA_ARGS__>;  \
 template<typename T> constexpr auto name ## __impl<T>::pattern()
 
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_ARENA_HPP
+#define AQUARIUS_CXX_INTERNAL_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "misc.hpp"
+
+namespace aquarius {
+
+/**
+ * non-owning pointer to object allocated in Arena. object is destroyed by Arena (clear(), rollback() or destructor).
+ * @tparam T
+ */
+template <typename T>
+class ArenaPtr {
+private:
+    T *ptr_;
+
+public:
+    ArenaPtr() : ptr_(nullptr) { }
+
+    explicit ArenaPtr(T *ptr) : ptr_(ptr) { }
+
+    template <typename U, misc::enable_when<std::is_convertible<U *, T *>::value> = nullptr>
+    ArenaPtr(const ArenaPtr<U> &p) : ptr_(p.get()) { }  //NOLINT
+
+    T *get() const {
+        return this->ptr_;
+    }
+
+    T &operator*() const {
+        return *this->ptr_;
+    }
+
+    T *operator->() const {
+        return this->ptr_;
+    }
+
+    explicit operator bool() const {
+        return this->ptr_ != nullptr;
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaPtr<T> &x, const ArenaPtr<U> &y) {
+    return x.get() == y.get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaPtr<T> &x, const ArenaPtr<U> &y) {
+    return x.get() != y.get();
+}
+
+/**
+ * bump pointer allocator. allocated objects are freed all at once.
+ * non-trivially destructible objects are destroyed in reverse order of allocation.
+ * memory blocks are kept until destruction of arena, so they are reused after clear() or rollback().
+ */
+class Arena : public misc::NonCopyable<Arena> {
+public:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    static constexpr std::size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+    /**
+     * allocation position of arena. see checkpoint() and rollback()
+     */
+    struct Checkpoint {
+        std::size_t block;
+        char *cursor;
+        void *dtor;
+    };
+
+private:
+    struct Block {
+        char *data;
+        std::size_t size;
+    };
+
+    /**
+     * allocated in front of non-trivially destructible object
+     */
+    struct Dtor {
+        void (*destroy)(void *);
+        Dtor *prev;
+    };
+
+    std::vector<Block> blocks_;
+
+    /**
+     * index of current block. if blocks_ is empty, meaningless
+     */
+    std::size_t index_{0};
+
+    char *cursor_{nullptr};
+
+    char *limit_{nullptr};
+
+    /**
+     * last allocated non-trivially destructible object
+     */
+    Dtor *dtor_{nullptr};
+
+    /**
+     * offset of object from Dtor
+     */
+    template <typename T>
+    static constexpr std::size_t objectOffset() {
+        return (sizeof(Dtor) + alignof(T) - 1) & ~(alignof(T) - 1);
+    }
+
+    template <typename T>
+    static void destroy(void *dtor) {
+        reinterpret_cast<T *>(static_cast<char *>(dtor) + objectOffset<T>())->~T();
+    }
+
+public:
+    Arena() = default;
+
+    Arena(Arena &&o) noexcept :
+            blocks_(std::move(o.blocks_)), index_(o.index_), cursor_(o.cursor_), limit_(o.limit_), dtor_(o.dtor_) {
+        o.blocks_.clear();
+        o.index_ = 0;
+        o.cursor_ = nullptr;
+        o.limit_ = nullptr;
+        o.dtor_ = nullptr;
+    }
+
+    ~Arena() {
+        this->clear();
+        for(auto &b : this->blocks_) {
+            std::free(b.data);
+        }
+    }
+
+    Arena &operator=(Arena &&o) noexcept {
+        auto tmp(std::move(o));
+        std::swap(this->blocks_, tmp.blocks_);
+        std::swap(this->index_, tmp.index_);
+        std::swap(this->cursor_, tmp.cursor_);
+        std::swap(this->limit_, tmp.limit_);
+        std::swap(this->dtor_, tmp.dtor_);
+        return *this;
+    }
+
+    /**
+     *
+     * @param size
+     * @param align
+     * must be power of 2
+     * @return
+     * uninitialized memory. never null
+     */
+    void *allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+        auto addr = reinterpret_cast<std::uintptr_t>(this->cursor_);
+        std::size_t pad = (align - (addr & (align - 1))) & (align - 1);
+        if(this->cursor_ == nullptr || size + pad > static_cast<std::size_t>(this->limit_ - this->cursor_)) {
+            this->nextBlock(size + align);
+            addr = reinterpret_cast<std::uintptr_t>(this->cursor_);
+            pad = (align - (addr & (align - 1))) & (align - 1);
+        }
+        char *ptr = this->cursor_ + pad;
+        this->cursor_ = ptr + size;
+        return ptr;
+    }
+
+    /**
+     * construct object in arena.
+     * @tparam T
+     * @tparam Arg
+     * @param arg
+     * @return
+     */
+    template <typename T, typename ... Arg>
+    ArenaPtr<T> create(Arg && ...arg) {
+        return ArenaPtr<T>(this->createImpl<T>(std::integral_constant<bool, std::is_trivially_destructible<T>::value>(),
+                                               std::forward<Arg>(arg)...));
+    }
+
+    Checkpoint checkpoint() const {
+        return Checkpoint{this->index_, this->cursor_, this->dtor_};
+    }
+
+    /**
+     * destroy objects allocated after checkpoint and reuse their memory.
+     * @param c
+     * must be obtained from this arena, and not be invalidated by preceding clear() or rollback()
+     */
+    void rollback(const Checkpoint &c) {
+        this->destroyUntil(static_cast<Dtor *>(c.dtor));
+        if(this->cursor_ == c.cursor) {
+            return;
+        }
+        this->index_ = c.block;
+        this->cursor_ = c.cursor;
+        this->limit_ = c.cursor == nullptr ? nullptr : this->blocks_[c.block].data + this->blocks_[c.block].size;
+    }
+
+    /**
+     * destroy all of objects. memory blocks are not freed.
+     */
+    void clear() {
+        this->rollback(Checkpoint{0, nullptr, nullptr});
+    }
+
+    /**
+     *
+     * @return
+     * total size of memory blocks
+     */
+    std::size_t capacity() const {
+        std::size_t size = 0;
+        for(auto &b : this->blocks_) {
+            size += b.size;
+        }
+        return size;
+    }
+
+    std::size_t blockCount() const {
+        return this->blocks_.size();
+    }
+
+private:
+    template <typename T, typename ... Arg>
+    T *createImpl(std::true_type, Arg && ...arg) {
+        return new(this->allocate(sizeof(T), alignof(T))) T(std::forward<Arg>(arg)...);
+    }
+
+    template <typename T, typename ... Arg>
+    T *createImpl(std::false_type, Arg && ...arg) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned type is not supported");
+
+        // allocate Dtor and object contiguously. Dtor is linked after construction of object
+        constexpr std::size_t align = alignof(Dtor) > alignof(T) ? alignof(Dtor) : alignof(T);
+        char *ptr = static_cast<char *>(this->allocate(objectOffset<T>() + sizeof(T), align));
+        T *obj = new(ptr + objectOffset<T>()) T(std::forward<Arg>(arg)...);
+        this->dtor_ = new(ptr) Dtor{&destroy<T>, this->dtor_};
+        return obj;
+    }
+
+    void destroyUntil(Dtor *last) {
+        while(this->dtor_ != last) {
+            Dtor *d = this->dtor_;
+            this->dtor_ = d->prev;
+            d->destroy(d);
+        }
+    }
+
+    void nextBlock(std::size_t required) {
+        if(this->cursor_ != nullptr) {
+            this->index_++;
+        } else {
+            this->index_ = 0;
+        }
+        for(; this->index_ < this->blocks_.size(); this->index_++) {   // reuse
+            if(this->blocks_[this->index_].size >= required) {
+                this->setBlock(this->index_);
+                return;
+            }
+        }
+
+        std::size_t size = this->blocks_.empty() ? BLOCK_SIZE : this->blocks_.back().size * 2;
+        if(size > MAX_BLOCK_SIZE) {
+            size = MAX_BLOCK_SIZE;
+        }
+        if(size < required) {
+            size = required;
+        }
+        auto *data = static_cast<char *>(std::malloc(size));
+        if(data == nullptr) {
+            abort();
+        }
+        this->blocks_.push_back(Block{data, size});
+        this->setBlock(this->blocks_.size() - 1);
+    }
+
+    void setBlock(std::size_t index) {
+        this->index_ = index;
+        this->cursor_ = this->blocks_[index].data;
+        this->limit_ = this->cursor_ + this->blocks_[index].size;
+    }
+};
+
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_ARENA_HPP
@@ -18,6 +18,7 @@
 #define AQUARIUS_CXX_INTERNAL_COMBINATOR_HPP
 
 #include "expression.hpp"
+#include "regular.hpp"
 
 namespace aquarius {
 namespace ascii {
@@ -83,10 +84,30 @@ constexpr auto set(const char (&text)[2]) {
     return ch(text[0]);
 }
 
+/**
+ * skip any bytes (including non-ascii) until one of delimiters. ex. skip_until("\"\\") for body of string
+ * @tparam N
+ * @param delims
+ * 1 to 4 bytes
+ * @return
+ */
+template <size_t N>
+constexpr auto skip_until(const char (&delims)[N]) {
+    static_assert(N >= 2 && N - 1 <= 4, "must be 1 to 4 bytes");
+    return expression::SkipUntil(simd::ByteSet(delims, N - 1));
+}
+
 constexpr expression::Empty EMPTY;
 
 constexpr expression::CaptureHolder text;
 
+constexpr expression::ViewCaptureHolder view;
+
+/**
+ * match regular void expression by deterministic automaton. ex. dfa[ *(ch('a') >> ch('b') | ch('c')) ]
+ */
+constexpr expression::RegularHolder dfa;
+
 template <size_t Low = 0, size_t High = static_cast<size_t>(-1), typename T, typename D>
 constexpr auto repeat(T expr, D delim) {
     return expression::repeatHelper<Low, High>(expr, delim);
@@ -114,7 +135,7 @@ constexpr auto operator-(T expr) {
 
 template <typename T, misc::enable_when<expression::is_expr<T>::value> = nullptr>
 constexpr auto operator!(T expr) {
-    return expression::NotPredicate<T>(expr);
+    return expression::notHelper(expr);
 }
 
 template <typename T, misc::enable_when<expression::is_expr<T>::value> = nullptr>
@@ -156,6 +177,16 @@ constexpr auto construct() {
     return mapper::Constructor<T>();
 }
 
+/**
+ * same as construct<T *>(), but construct object in arena. require ArenaPolicy
+ * @tparam T
+ * @return
+ */
+template <typename T>
+constexpr auto allocate() {
+    return mapper::ArenaConstructor<T>();
+}
+
 template <typename T>
 constexpr auto supply(T t) {
     return mapper::Supplier<T>(t);
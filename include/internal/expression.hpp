@@ -22,16 +22,79 @@
 #include <string>
 #include <cstdint>
 #include <functional>
+#include <tuple>
 
 #include "state.hpp"
 #include "misc.hpp"
 #include "tuples.hpp"
 #include "unicode.hpp"
+#include "simd.hpp"
 
 namespace aquarius {
 namespace expression {
 
-struct Expression { };
+/**
+ * max length of expression which may consume unbounded input
+ */
+constexpr std::size_t INFINITE_LENGTH = static_cast<std::size_t>(-1);
+
+/**
+ * addition of lengths. saturated at INFINITE_LENGTH
+ */
+constexpr std::size_t addLength(std::size_t x, std::size_t y) {
+    return x > INFINITE_LENGTH - y ? INFINITE_LENGTH : x + y;
+}
+
+/**
+ * multiplication of lengths. saturated at INFINITE_LENGTH
+ */
+constexpr std::size_t mulLength(std::size_t x, std::size_t n) {
+    return n != 0 && x > INFINITE_LENGTH / n ? INFINITE_LENGTH : x * n;
+}
+
+/**
+ * base of all expressions.
+ * firstSet() and nullable() are used for skipping alternatives of choice without trying them.
+ * minLength() is used for failing sequence without trying it, if remaining input is short.
+ * default is conservative (may start with any byte and may match empty, and may consume unbounded input).
+ */
+struct Expression {
+    /**
+     *
+     * @return
+     * set of bytes which may be consumed first
+     */
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap::full();
+    }
+
+    /**
+     *
+     * @return
+     * if true, may match without consuming input
+     */
+    constexpr bool nullable() const {
+        return true;
+    }
+
+    /**
+     *
+     * @return
+     * min size of input consumed by successful match
+     */
+    constexpr std::size_t minLength() const {
+        return 0;
+    }
+
+    /**
+     *
+     * @return
+     * max size of input consumed by successful match. if unbounded, INFINITE_LENGTH
+     */
+    constexpr std::size_t maxLength() const {
+        return INFINITE_LENGTH;
+    }
+};
 
 template <typename T>
 struct is_expr : std::is_base_of<Expression, T> { };
@@ -41,41 +104,162 @@ struct ExprBase : Expression {
     using retType = T;
 };
 
+/**
+ * void type expression implements match(cursor, state), which takes cursor by value and returns
+ * new cursor and result. so void type expressions can keep cursor in register while matching.
+ * its operator() is only adapter to ParserState (for value type expression).
+ * @param expr
+ * @param state
+ */
+template <typename T, typename Iterator, typename Policy>
+inline void applyMatch(const T &expr, ParserState<Iterator, Policy> &state) {
+    auto r = expr.match(state.cursor(), state);
+    state.cursor() = r.pos;
+    state.setResult(r.success);
+}
+
+/**
+ * roll back arena allocations of failed value type expression. if Policy::useArena is false, do nothing.
+ * only value type expression allocates (void type expression never has mapper).
+ */
+template <typename Policy, bool = Policy::useArena>
+struct ArenaGuard {
+    template <typename Iterator>
+    explicit ArenaGuard(ParserState<Iterator, Policy> &) { }
+
+    template <typename Iterator>
+    void rollbackIfFailed(ParserState<Iterator, Policy> &) const { }
+};
+
+template <typename Policy>
+struct ArenaGuard<Policy, true> {
+    Arena::Checkpoint checkpoint;
+
+    template <typename Iterator>
+    explicit ArenaGuard(ParserState<Iterator, Policy> &state) : checkpoint(state.policy().arena().checkpoint()) { }
+
+    template <typename Iterator>
+    void rollbackIfFailed(ParserState<Iterator, Policy> &state) const {
+        if(!state.result()) {
+            state.policy().arena().rollback(this->checkpoint);
+        }
+    }
+};
+
 struct Empty : ExprBase<void> {
     constexpr Empty() {}    //NOLINT
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &) const { }
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &) const { }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &) const {
+        return {cursor, true};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap();
+    }
+
+    constexpr bool nullable() const {
+        return true;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 0;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 0;
+    }
 };
 
 struct Any : ExprBase<void> {
     constexpr Any() {}  //NOLINT
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.cursor() == state.end() || *state.cursor() < 0) {
-            state.reportFailure();
-        } else {
-            ++state.cursor();
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(cursor == state.end() || *cursor < 0) {
+            state.reportFailureAt(cursor, *this);
+            return {cursor, false};
         }
+        return {cursor + 1, true};
+    }
+
+    /**
+     * fixed width expression provides width() and test(cursor), which matches without bounds check.
+     * caller must ensure that at least width() bytes remain.
+     */
+    constexpr std::size_t width() const {
+        return 1;
+    }
+
+    template <typename Iterator>
+    bool test(Iterator cursor) const {
+        return *cursor >= 0;
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap().addRange(0x00, 0x7F);
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 1;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 1;
     }
 };
 
 struct Utf8Any : ExprBase<void>, unicode_util::Utf8Util<true> {
     constexpr Utf8Any() {}  //NOLINT
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.remainedSize() > 0) {
-            unsigned int size = this->utf8ByteSize(*state.cursor());
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const auto remain = static_cast<std::size_t>(state.end() - cursor);
+        if(remain > 0) {
+            unsigned int size = this->utf8ByteSize(*cursor);
             if(size > 0 && size < 5) {
-                if(state.remainedSize() >= size) {
-                    state.cursor() += size;
-                    return;
+                if(remain >= size) {
+                    return {cursor + size, true};
                 }
+                state.reportShortInputAt(cursor, *this);
+                return {cursor, false};
             }
         }
-        state.reportFailure();
+        state.reportFailureAt(cursor, *this);
+        return {cursor, false};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::utf8LeadBytes(0, 0x1FFFFF);
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 1;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 4;
     }
 };
 
@@ -86,21 +270,151 @@ struct StringLiteral : ExprBase<void> {
     constexpr explicit StringLiteral(const char *text, std::size_t size) :
             size(size), text(text) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.cursor() + this->size > state.end()) {
-            state.reportFailure();
-        } else {
-            auto old = state.cursor();
-            for(unsigned int i = 0; i < this->size; i++) {
-                if(this->text[i] != *state.cursor()) {
-                    state.reportFailure();
-                    state.cursor() = old;
-                    break;
-                }
-                ++state.cursor();
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy,
+            misc::enable_when<!misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(cursor + this->size > state.end()) {
+            state.reportShortInputAt(cursor, *this);
+            return {cursor, false};
+        }
+        for(unsigned int i = 0; i < this->size; i++) {
+            if(this->text[i] != cursor[i]) {
+                state.reportFailureAt(cursor + i, StringLiteral(this->text + i, this->size - i));
+                return {cursor, false};
+            }
+        }
+        return {cursor + this->size, true};
+    }
+
+    /**
+     * for contiguous input. compare by byte block
+     */
+    template <typename Iterator, typename Policy,
+            misc::enable_when<misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(static_cast<std::size_t>(state.end() - cursor) < this->size) {
+            state.reportShortInputAt(cursor, *this);
+            return {cursor, false};
+        }
+        if(this->size > 0) {
+            std::size_t index = simd::mismatch(misc::toPointer(cursor), this->text, this->size);
+            if(index != this->size) {
+                state.reportFailureAt(cursor + index, StringLiteral(this->text + index, this->size - index));
+                return {cursor, false};
+            }
+        }
+        return {cursor + this->size, true};
+    }
+
+    constexpr std::size_t width() const {
+        return this->size;
+    }
+
+    template <typename Iterator, misc::enable_when<!misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    bool test(Iterator cursor) const {
+        for(unsigned int i = 0; i < this->size; i++) {
+            if(this->text[i] != cursor[i]) {
+                return false;
             }
         }
+        return true;
+    }
+
+    template <typename Iterator, misc::enable_when<misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    bool test(Iterator cursor) const {
+        return simd::mismatch(misc::toPointer(cursor), this->text, this->size) == this->size;
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->size == 0 ? unicode_util::ByteMap() :
+               unicode_util::ByteMap() + static_cast<unsigned char>(this->text[0]);
+    }
+
+    constexpr bool nullable() const {
+        return this->size == 0;
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->size;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->size;
+    }
+};
+
+/**
+ * string literal which text is stored inline. built from sequence of Char (see seqHelper).
+ * @tparam N
+ */
+template <std::size_t N>
+struct CharString : ExprBase<void> {
+    char text[N];
+
+    constexpr CharString() : text{} { }
+
+    template <std::size_t M>
+    constexpr CharString<N + M> operator+(const CharString<M> &str) const {
+        CharString<N + M> value;
+        for(std::size_t i = 0; i < N; i++) {
+            value.text[i] = this->text[i];
+        }
+        for(std::size_t i = 0; i < M; i++) {
+            value.text[N + i] = str.text[i];
+        }
+        return value;
+    }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    /**
+     * same as sequence of Char. if input is short, report failure at first mismatch or end of input
+     */
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const auto remain = static_cast<std::size_t>(state.end() - cursor);
+        const std::size_t size = remain < N ? remain : N;
+        const StringLiteral literal(this->text, size);
+        if(size == N && literal.test(cursor)) {
+            return {cursor + N, true};
+        }
+        std::size_t index = 0;
+        for(; index < size && this->text[index] == cursor[index]; index++);
+        state.reportFailureAt(cursor + index, StringLiteral(this->text + index, N - index));
+        return {cursor, false};
+    }
+
+    constexpr std::size_t width() const {
+        return N;
+    }
+
+    template <typename Iterator>
+    bool test(Iterator cursor) const {
+        return StringLiteral(this->text, N).test(cursor);
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap() + static_cast<unsigned char>(this->text[0]);
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return N;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return N;
     }
 };
 
@@ -110,13 +424,43 @@ struct Char : ExprBase<void> {
 
     constexpr explicit Char(char ch) : ch(ch) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.cursor() != state.end() && *state.cursor() == this->ch) {
-            ++state.cursor();
-        } else {
-            state.reportFailure();
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(cursor != state.end() && *cursor == this->ch) {
+            return {cursor + 1, true};
         }
+        state.reportFailureAt(cursor, *this);
+        return {cursor, false};
+    }
+
+    constexpr std::size_t width() const {
+        return 1;
+    }
+
+    template <typename Iterator>
+    bool test(Iterator cursor) const {
+        return *cursor == this->ch;
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap() + static_cast<unsigned char>(this->ch);
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 1;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 1;
     }
 };
 
@@ -125,18 +469,47 @@ struct Utf8Char : ExprBase<void>, unicode_util::Utf8Util<true> {
 
     constexpr explicit Utf8Char(char32_t ch) : ch(ch) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.remainedSize() > 0) {
-            auto pair = this->toCodePoint(state.cursor(), state.end());
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const auto remain = static_cast<std::size_t>(state.end() - cursor);
+        if(remain > 0) {
+            auto pair = this->toCodePoint(cursor, state.end());
             if(pair.byteSize > 0 && pair.byteSize < 5) {
+                if(pair.byteSize > remain) {
+                    state.reportShortInputAt(cursor, *this);
+                    return {cursor, false};
+                }
                 if(static_cast<char32_t>(pair.code) == ch) {
-                    state.cursor() += pair.byteSize;
-                    return;
+                    return {cursor + pair.byteSize, true};
                 }
             }
         }
-        state.reportFailure();
+        state.reportFailureAt(cursor, *this);
+        return {cursor, false};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::utf8LeadBytes(this->ch, this->ch);
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    /**
+     * overlong form is longer than shortest form
+     */
+    constexpr std::size_t minLength() const {
+        return this->ch < 0x80 ? 1 : this->ch < 0x800 ? 2 : this->ch < 0x10000 ? 3 : 4;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 4;
     }
 };
 
@@ -145,13 +518,43 @@ struct CharClass : ExprBase<void> {
 
     constexpr explicit CharClass(unicode_util::AsciiMap asciiMap) : asciiMap(asciiMap) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.cursor() == state.end() || !this->asciiMap.contains(*state.cursor())) {
-            state.reportFailure();
-        } else {
-            ++state.cursor();
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(cursor == state.end() || !this->asciiMap.contains(*cursor)) {
+            state.reportFailureAt(cursor, *this);
+            return {cursor, false};
         }
+        return {cursor + 1, true};
+    }
+
+    constexpr std::size_t width() const {
+        return 1;
+    }
+
+    template <typename Iterator>
+    bool test(Iterator cursor) const {
+        return this->asciiMap.contains(*cursor);
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap(this->asciiMap);
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 1;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 1;
     }
 };
 
@@ -161,27 +564,107 @@ struct Utf8CharClass : ExprBase<void>, unicode_util::Utf8Util<true> {
 
     constexpr Utf8CharClass(const char32_t *text, std::size_t size) : text(text), size(size) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        if(state.remainedSize() > 0) {
-            auto pair = this->toCodePoint(state.cursor(), state.end());
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const auto remain = static_cast<std::size_t>(state.end() - cursor);
+        if(remain > 0) {
+            auto pair = this->toCodePoint(cursor, state.end());
             if(pair.byteSize > 0 && pair.byteSize < 5) {
+                if(pair.byteSize > remain) {
+                    state.reportShortInputAt(cursor, *this);
+                    return {cursor, false};
+                }
                 auto code = static_cast<char32_t>(pair.code);
                 for(unsigned int i = 0; i < this->size; i++) {
                     if(this->text[i] == U'-' && i > 0 && i + 1 < size) {
                         if(code > this->text[i - 1] && code <= this->text[i + 1]) {
-                            state.cursor() += pair.byteSize;
-                            return;
+                            return {cursor + pair.byteSize, true};
                         }
                         i++;
                     } else if(code == this->text[i]) {
-                        state.cursor() += pair.byteSize;
-                        return;
+                        return {cursor + pair.byteSize, true};
                     }
                 }
             }
         }
-        state.reportFailure();
+        state.reportFailureAt(cursor, *this);
+        return {cursor, false};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        unicode_util::ByteMap byteMap;
+        for(unsigned int i = 0; i < this->size; i++) {
+            if(this->text[i] == U'-' && i > 0 && i + 1 < this->size) {
+                byteMap = byteMap + unicode_util::utf8LeadBytes(this->text[i - 1] + 1, this->text[i + 1]);
+                i++;
+            } else {
+                byteMap = byteMap + unicode_util::utf8LeadBytes(this->text[i], this->text[i]);
+            }
+        }
+        return byteMap;
+    }
+
+    constexpr bool nullable() const {
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 1;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 4;
+    }
+};
+
+/**
+ * skip bytes until one of delimiter bytes (or end of input). delimiter is not consumed.
+ * on contiguous input, search by memchr or byte block.
+ */
+struct SkipUntil : ExprBase<void> {
+    simd::ByteSet delims;
+
+    constexpr explicit SkipUntil(simd::ByteSet delims) : delims(delims) { }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy,
+            misc::enable_when<misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const auto size = static_cast<std::size_t>(state.end() - cursor);
+        cursor += size == 0 ? 0 : simd::findByte(misc::toPointer(cursor), size, this->delims);
+        state.reportFailureAt(cursor, *this);
+        return {cursor, true};
+    }
+
+    template <typename Iterator, typename Policy,
+            misc::enable_when<!misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        for(; cursor != state.end() && !this->delims.contains(*cursor); ++cursor);
+        state.reportFailureAt(cursor, *this);
+        return {cursor, true};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        unicode_util::ByteMap map;
+        for(unsigned int b = 0; b < 256; b++) {
+            if(!this->delims.contains(static_cast<char>(b))) {
+                map = map + static_cast<unsigned char>(b);
+            }
+        }
+        return map;
+    }
+
+    constexpr bool nullable() const {
+        return true;
     }
 };
 
@@ -192,13 +675,29 @@ struct UnaryExpr : Expression {
     T expr;
 
     constexpr explicit UnaryExpr(T expr) : expr(expr) { }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->expr.minLength();
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->expr.maxLength();
+    }
 };
 
 template <typename T, typename D, size_t Low, size_t High>
 struct RepeatBaseCommon : UnaryExpr<T> {
     static_assert(is_expr<D>::value, "must be Expression");
     static_assert(std::is_void<typename D::retType>::value, "must be void type");
-    static_assert(Low < High, "invalid interval");
+    static_assert(Low <= High, "invalid interval");
 
     constexpr explicit RepeatBaseCommon(T expr) : UnaryExpr<T>(expr) {}
 
@@ -219,24 +718,67 @@ struct RepeatBase : RepeatBaseCommon<T, D, Low, High> {
 
     constexpr RepeatBase(T expr, D delim) : RepeatBaseCommon<T, D, Low, High>(expr), delim(delim) { }
 
-    template <typename Iterator>
-    bool matchDelim(ParserState<Iterator> &state, size_t index) const {
+    template <typename Iterator, typename Policy>
+    bool matchDelim(ParserState<Iterator, Policy> &state, size_t index) const {
         if(index > 0) {
             this->delim(state);
             return state.result();
         }
         return true;
     }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> matchDelim(Iterator cursor, ParserState<Iterator, Policy> &state, size_t index) const {
+        if(index > 0) {
+            return this->delim.match(cursor, state);
+        }
+        return {cursor, true};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.nullable() ? this->expr.firstSet() + this->delim.firstSet() : this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return Low == 0 || this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return Low == 0 ? 0 : addLength(mulLength(this->expr.minLength(), Low),
+                                        mulLength(this->delim.minLength(), Low - 1));
+    }
+
+    constexpr std::size_t maxLength() const {
+        return High == 0 ? 0 : addLength(mulLength(this->expr.maxLength(), High),
+                                         mulLength(this->delim.maxLength(), High - 1));
+    }
 };
 
 template <typename T, size_t Low, size_t High>
 struct RepeatBase<T, Empty, Low, High> : RepeatBaseCommon<T, Empty, Low, High> {
     constexpr RepeatBase(T expr, Empty) : RepeatBaseCommon<T, Empty, Low, High>(expr) { }
 
-    template <typename Iterator>
-    bool matchDelim(ParserState<Iterator> &, size_t) const {
+    template <typename Iterator, typename Policy>
+    bool matchDelim(ParserState<Iterator, Policy> &, size_t) const {
         return true;
     }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> matchDelim(Iterator cursor, ParserState<Iterator, Policy> &, size_t) const {
+        return {cursor, true};
+    }
+
+    constexpr bool nullable() const {
+        return Low == 0 || this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return mulLength(this->expr.minLength(), Low);
+    }
+
+    constexpr std::size_t maxLength() const {
+        return mulLength(this->expr.maxLength(), High);
+    }
 };
 
 template <typename T, typename D, size_t Low, size_t High>
@@ -247,28 +789,82 @@ struct RepeatVoid : RepeatBase<T, D, Low, High> {
 
     constexpr RepeatVoid(T expr, D delim) : RepeatBase<T, D, Low, High>(expr, delim) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
         size_t index = 0;
         for(; index < High; index++) {
             // match delimiter
-            if(!this->matchDelim(state, index)) {
+            auto r = this->matchDelim(cursor, state, index);
+            cursor = r.pos;
+            if(!r.success) {
                 break;
             }
 
             // match expression
-            this->expr(state);
-            if(!state.result()) {
+            r = this->expr.match(cursor, state);
+            cursor = r.pos;
+            if(!r.success) {
                 break;
             }
         }
+        return {cursor, this->isGreaterThan(index, Low)};
+    }
+};
+
+/**
+ * for repetition of character class without delimiter (ex. *set(" \t\r\n")).
+ * if input is contiguous, skip matched characters by block.
+ */
+template <size_t Low, size_t High>
+struct RepeatVoid<CharClass, Empty, Low, High> : RepeatBase<CharClass, Empty, Low, High> {
+    using retType = void;
+
+    simd::ClassTable table;
+
+    constexpr RepeatVoid(CharClass expr, Empty delim) :
+            RepeatBase<CharClass, Empty, Low, High>(expr, delim),
+            table(expr.asciiMap.map[0], expr.asciiMap.map[1]) { }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy,
+            misc::enable_when<misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        auto size = static_cast<std::size_t>(state.end() - cursor);
+        if(size > High) {
+            size = High;
+        }
+        const std::size_t count = size == 0 ? 0 : simd::spanClass(misc::toPointer(cursor), size, this->table);
+        return this->finish(cursor + count, state, count);
+    }
 
-        if(this->isGreaterThan(index, Low)) {
-            state.setResult(true);
+    template <typename Iterator, typename Policy,
+            misc::enable_when<!misc::is_contiguous_char_iter<Iterator>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        std::size_t count = 0;
+        for(; count < High && cursor != state.end() && this->table.contains(*cursor); ++cursor) {
+            count++;
         }
+        return this->finish(cursor, state, count);
     }
-};
 
+private:
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> finish(Iterator cursor, ParserState<Iterator, Policy> &state, std::size_t count) const {
+        if(count < High) {  // stopped by mismatch or end of input
+            state.reportFailureAt(cursor, this->expr);
+        }
+        return {cursor, this->isGreaterThan(count, Low)};
+    }
+};
 
 template <typename T, typename D, size_t Low, size_t High>
 struct Repeat : RepeatBase<T, D, Low, High> {
@@ -280,8 +876,8 @@ struct Repeat : RepeatBase<T, D, Low, High> {
 
     constexpr Repeat(T expr, D delim) : RepeatBase<T, D, Low, High>(expr, delim) { }
 
-    template <typename Iterator>
-    std::vector<exprType> operator()(ParserState<Iterator> &state) const {
+    template <typename Iterator, typename Policy>
+    std::vector<exprType> operator()(ParserState<Iterator, Policy> &state) const {
         std::vector<exprType> value;
 
         size_t index = 0;
@@ -292,8 +888,10 @@ struct Repeat : RepeatBase<T, D, Low, High> {
             }
 
             // match expression
+            ArenaGuard<Policy> guard(state);
             auto v = this->expr(state);
             if(!state.result()) {
+                guard.rollbackIfFailed(state);
                 break;
             }
 
@@ -307,12 +905,78 @@ struct Repeat : RepeatBase<T, D, Low, High> {
     }
 };
 
+template <typename T>
+constexpr auto hasFixedWidth(int) -> decltype(std::declval<const T &>().width(), true) {
+    return true;
+}
+
+template <typename T>
+constexpr bool hasFixedWidth(long) {
+    return false;
+}
+
+/**
+ * repeat<N, N> of fixed width expression. remaining size is checked once, and then each element is matched
+ * without bounds check.
+ * @tparam T
+ * @tparam N
+ */
+template <typename T, size_t N>
+struct RepeatFixed : RepeatBase<T, Empty, N, N> {
+    using retType = void;
+
+    constexpr explicit RepeatFixed(T expr) : RepeatBase<T, Empty, N, N>(expr, Empty()) { }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const std::size_t width = this->expr.width();
+        if(static_cast<std::size_t>(state.end() - cursor) < N * width) {
+            return RepeatVoid<T, Empty, N, N>(this->expr, Empty()).match(cursor, state);
+        }
+        for(size_t index = 0; index < N; index++) {
+            if(!this->expr.test(cursor)) {
+                return {this->expr.match(cursor, state).pos, false};  // report failure
+            }
+            cursor += width;
+        }
+        return {cursor, true};
+    }
+
+    constexpr std::size_t width() const {
+        return N * this->expr.width();
+    }
+
+    template <typename Iterator>
+    bool test(Iterator cursor) const {
+        for(size_t index = 0; index < N; index++) {
+            if(!this->expr.test(cursor)) {
+                return false;
+            }
+            cursor += this->expr.width();
+        }
+        return true;
+    }
+};
+
 template <size_t Low, size_t High, typename T, typename D,
-        misc::enable_when<is_expr<T>::value && std::is_void<typename T::retType>::value> = nullptr>
+        misc::enable_when<is_expr<T>::value && std::is_void<typename T::retType>::value &&
+                          !(Low == High && std::is_same<D, Empty>::value && hasFixedWidth<T>(0))> = nullptr>
 constexpr auto repeatHelper(T expr, D delim) {
     return RepeatVoid<T, D, Low, High>(expr, delim);
 }
 
+template <size_t Low, size_t High, typename T, typename D,
+        misc::enable_when<is_expr<T>::value && std::is_void<typename T::retType>::value &&
+                          Low == High && std::is_same<D, Empty>::value && hasFixedWidth<T>(0)> = nullptr>
+constexpr auto repeatHelper(T expr, D) {
+    return RepeatFixed<T, Low>(expr);
+}
+
 template <size_t Low, size_t High, typename T, typename D,
         misc::enable_when<is_expr<T>::value && !std::is_void<typename T::retType>::value> = nullptr>
 constexpr auto repeatHelper(T expr, D delim) {
@@ -327,12 +991,22 @@ struct OptionVoid : UnaryExpr<T> {
 
     constexpr explicit OptionVoid(T expr) : UnaryExpr<T>(expr) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        this->expr(state);
-        if(!state.result()) {
-            state.setResult(true);
-        }
+    constexpr bool nullable() const {
+        return true;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 0;
+    }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        return {this->expr.match(cursor, state).pos, true};
     }
 };
 
@@ -345,13 +1019,23 @@ struct Option : UnaryExpr<T> {
 
     constexpr explicit Option(T expr) : UnaryExpr<T>(expr) { }
 
-    template <typename Iterator>
-    Optional<exprType> operator()(ParserState<Iterator> &state) const {
+    constexpr bool nullable() const {
+        return true;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 0;
+    }
+
+    template <typename Iterator, typename Policy>
+    Optional<exprType> operator()(ParserState<Iterator, Policy> &state) const {
         Optional<exprType> value;
+        ArenaGuard<Policy> guard(state);
         auto v = this->expr(state);
         if(state.result()) {
-            value = Optional<exprType>(std::move(v));
+            value.emplace(std::move(v));
         } else {
+            guard.rollbackIfFailed(state);
             state.setResult(true);
         }
         return value;
@@ -380,19 +1064,54 @@ struct NotPredicate : UnaryExpr<T> {
 
     constexpr explicit NotPredicate(T expr) : UnaryExpr<T>(expr) { }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        auto old = state.cursor();
-        this->expr(state);
-        if(state.result()) {
-            state.reportFailure();
-            state.cursor() = old;
-        } else {
-            state.setResult(true);
+    /**
+     * never consume input
+     */
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap();
+    }
+
+    constexpr bool nullable() const {
+        return true;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 0;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 0;
+    }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        auto r = this->expr.match(cursor, state);
+        if(r.success) {
+            state.reportFailureAt(r.pos);
+            return {cursor, false};
         }
+        return {r.pos, true};
     }
 };
 
+template <typename T, misc::enable_when<is_expr<T>::value> = nullptr>
+constexpr auto notHelper(T expr) {
+    return NotPredicate<T>(expr);
+}
+
+/**
+ * !(!(!e)) => !e
+ */
+template <typename T>
+constexpr auto notHelper(NotPredicate<NotPredicate<T>> expr) {
+    return expr.expr;
+}
+
 template <typename T>
 struct Capture : ExprBase<std::string> {
     static_assert(is_expr<T>::value, "must be Expression");
@@ -405,8 +1124,24 @@ struct Capture : ExprBase<std::string> {
 
     constexpr explicit Capture(T expr) : expr(expr) { }
 
-    template <typename Iterator>
-    std::string operator()(ParserState<Iterator> &state) const {
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->expr.minLength();
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->expr.maxLength();
+    }
+
+    template <typename Iterator, typename Policy>
+    std::string operator()(ParserState<Iterator, Policy> &state) const {
         std::string str;
         auto old = state.cursor();
         this->expr(state);
@@ -426,231 +1161,1310 @@ struct CaptureHolder {
     }
 };
 
+/**
+ * capture matched input without copy. only available in contiguous input.
+ * @tparam T
+ */
+template <typename T>
+struct ViewCapture : ExprBase<StringView> {
+    static_assert(is_expr<T>::value, "must be Expression");
 
-template <typename L, typename R>
-struct BinaryExpr : Expression {
-    static_assert(is_expr<L>::value && is_expr<R>::value, "must be Expression");
-
-    L left;
-    R right;
+    using exprType = typename T::retType;
 
-    constexpr BinaryExpr(L left, R right) : left(left), right(right) { }
-};
+    static_assert(std::is_void<exprType>::value, "must be void type");
 
-template <typename L, typename R>
-struct SequenceVoid : BinaryExpr<L, R> {
-    static_assert(std::is_void<typename L::retType>::value
-                  && std::is_void<typename R::retType>::value, "left and right expression must be void type");
+    T expr;
 
-    using retType = void;
+    constexpr explicit ViewCapture(T expr) : expr(expr) { }
 
-    constexpr SequenceVoid(L left, R right) : BinaryExpr<L, R>(left, right) { }
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.firstSet();
+    }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        auto old = state.cursor();
-        this->left(state);
-        if(state.result()) {
-            this->right(state);
-            if(!state.result()) {
-                state.cursor() = old;
-            }
-        }
+    constexpr bool nullable() const {
+        return this->expr.nullable();
     }
-};
 
-template <typename L, typename R>
-struct SequenceRightVoid : BinaryExpr<L, R> {
-    static_assert(!std::is_void<typename L::retType>::value
-                  && std::is_void<typename R::retType>::value, "right expression must be void type");
+    constexpr std::size_t minLength() const {
+        return this->expr.minLength();
+    }
 
-    using retType = typename L::retType;
+    constexpr std::size_t maxLength() const {
+        return this->expr.maxLength();
+    }
 
-    constexpr SequenceRightVoid(L left, R right) : BinaryExpr<L, R>(left, right) { }
+    template <typename Iterator, typename Policy>
+    StringView operator()(ParserState<Iterator, Policy> &state) const {
+        static_assert(misc::is_contiguous_char_iter<Iterator>::value, "require contiguous input");
 
-    template <typename Iterator>
-    retType operator()(ParserState<Iterator> &state) const {
+        StringView view;
         auto old = state.cursor();
-        auto v = this->left(state);
-        if(state.result()) {
-            this->right(state);
-            if(!state.result()) {
-                state.cursor() = old;
-            }
+        this->expr(state);
+        if(state.result() && old != state.cursor()) {
+            view = StringView(misc::toPointer(old), static_cast<std::size_t>(state.cursor() - old));
         }
-        return v;
+        return view;
     }
 };
 
-template <typename L, typename R>
-struct SequenceLeftVoid : BinaryExpr<L, R> {
-    static_assert(std::is_void<typename L::retType>::value
-                  && !std::is_void<typename R::retType>::value, "left expression must be void type");
+struct ViewCaptureHolder {
+    constexpr ViewCaptureHolder() {}    //NOLINT
 
-    using retType = typename R::retType;
+    template <typename T>
+    constexpr ViewCapture<T> operator[](T expr) const {
+        return ViewCapture<T>(expr);
+    }
+};
 
-    constexpr SequenceLeftVoid(L left, R right) : BinaryExpr<L, R>(left, right) { }
 
-    template <typename Iterator>
-    retType operator()(ParserState<Iterator> &state) const {
-        auto old = state.cursor();
-        retType v;
-        this->left(state);
-        if(state.result()) {
-            v = this->right(state);
-            if(!state.result()) {
-                state.cursor() = old;
-            }
-        }
-        return v;
-    }
+template <typename ... T>
+struct NaryExpr : Expression {
+    static_assert(misc::allOf({is_expr<T>::value...}), "must be Expression");
+
+    std::tuple<T ...> exprs;
+
+    constexpr explicit NaryExpr(std::tuple<T ...> exprs) : exprs(exprs) { }
 };
 
-template <typename L, typename R>
-struct Sequence : BinaryExpr<L, R> {
-    static_assert(!std::is_void<typename L::retType>::value
-                  && !std::is_void<typename R::retType>::value, "left and right expression must not be void type");
+/**
+ * flattened sequence (a >> b >> c ...).
+ * cursor is saved once, and value of each expression is directly stored into result tuple.
+ * if all of expressions are void type, void. if only one expression is not void type, its type.
+ * otherwise, flattened tuple of values.
+ */
+template <typename ... T>
+struct Sequence : NaryExpr<T ...> {
+    using retType = misc::cat_type_t<typename T::retType...>;
 
-    using leftType = typename L::retType;
-    using rightType = typename R::retType;
+    constexpr explicit Sequence(std::tuple<T ...> exprs) : NaryExpr<T ...>(exprs) { }
 
-    using retType = decltype(misc::catAsTuple(leftType(), rightType()));
+    /**
+     * if true, all of expressions are fixed width (see Any::width()). so does sequence
+     */
+    static constexpr bool fixedWidth() {
+        return misc::allOf({hasFixedWidth<T>(0)...});
+    }
 
-    constexpr Sequence(L left, R right) : BinaryExpr<L, R>(left, right) { }
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
 
-    template <typename Iterator>
-    retType operator()(ParserState<Iterator> &state) const {
-        leftType v1;
-        rightType v2;
-        auto old = state.cursor();
-        v1 = this->left(state);
-        if(state.result()) {
-            v2 = this->right(state);
-            if(!state.result()) {
-                state.cursor() = old;
-            }
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<!std::is_void<P>::value> = nullptr>
+    retType operator()(ParserState<Iterator, Policy> &state) const {
+        retType value = retType();
+        this->matchFrom<0>(state, state.cursor(), value);
+        return value;
+    }
+
+    /**
+     * if all of expressions are void type
+     */
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(Policy::trackFailure && !fixedWidth()) {
+            return this->matchFrom<0>(cursor, cursor, state);
+        }
+        if(static_cast<std::size_t>(state.end() - cursor) >= this->minLength()) {
+            return this->matchEnough(cursor, state);
+        }
+        if(Policy::trackFailure) {
+            return this->matchFrom<0>(cursor, cursor, state);
         }
-        return misc::catAsTuple(std::move(v1), std::move(v2));
+
+        // remaining input is shorter than min length, so never match.
+        // first expression is still tried for leaving cursor at same position as usual
+        state.reportShortInputAt(cursor);
+        auto r = std::get<0>(this->exprs).match(cursor, state);
+        return {r.success ? cursor : r.pos, false};
     }
-};
 
-template <typename L, typename R,
-        misc::enable_when<is_expr<L>::value && is_expr<R>::value
-                          && std::is_void<typename L::retType>::value
-                          && std::is_void<typename R::retType>::value> = nullptr>
-constexpr auto seqHelper(L left, R right) {
-    return SequenceVoid<L, R>(left, right);
-}
+    template <typename P = retType, misc::enable_when<std::is_void<P>::value && fixedWidth()> = nullptr>
+    constexpr std::size_t width() const {
+        return this->minLength();
+    }
 
-template <typename L, typename R,
-        misc::enable_when<is_expr<L>::value && is_expr<R>::value
-                          && !std::is_void<typename L::retType>::value
-                          && std::is_void<typename R::retType>::value> = nullptr>
-constexpr auto seqHelper(L left, R right) {
-    return SequenceRightVoid<L, R>(left, right);
-}
+    template <typename Iterator, typename P = retType,
+            misc::enable_when<std::is_void<P>::value && fixedWidth()> = nullptr>
+    bool test(Iterator cursor) const {
+        return this->testFrom<0>(cursor);
+    }
 
-template <typename L, typename R,
-        misc::enable_when<is_expr<L>::value && is_expr<R>::value
-                          && std::is_void<typename L::retType>::value
-                          && !std::is_void<typename R::retType>::value> = nullptr>
-constexpr auto seqHelper(L left, R right) {
-    return SequenceLeftVoid<L, R>(left, right);
-}
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->firstSetFrom<0>();
+    }
 
-template <typename L, typename R,
-        misc::enable_when<is_expr<L>::value && is_expr<R>::value
-                          && !std::is_void<typename L::retType>::value
-                          && !std::is_void<typename R::retType>::value> = nullptr>
-constexpr auto seqHelper(L left, R right) {
-    return Sequence<L, R>(left, right);
-}
+    constexpr bool nullable() const {
+        return this->nullableFrom<0>();
+    }
 
+    constexpr std::size_t minLength() const {
+        return this->minLengthFrom<0>();
+    }
 
-template <typename L, typename R>
-struct ChoiceVoid : BinaryExpr<L, R> {
-    using leftType = typename L::retType;
-    using rightType = typename R::retType;
+    constexpr std::size_t maxLength() const {
+        return this->maxLengthFrom<0>();
+    }
 
-    static_assert(std::is_void<leftType>::value && std::is_void<rightType>::value, "must be void type");
+private:
+    template <std::size_t I>
+    using exprType = typename std::tuple_element<I, std::tuple<T ...>>::type::retType;
 
-    using retType = void;
+    static constexpr bool singleValue() {
+        return misc::count_non_void<typename T::retType...>::value == 1;
+    }
 
-    constexpr ChoiceVoid(L left, R right) : BinaryExpr<L, R>(left, right) { }
+    /**
+     *
+     * @param index
+     * @return
+     * start index of value of index-th expression in result tuple
+     */
+    static constexpr std::size_t offsetOf(std::size_t index) {
+        const std::size_t widths[] = {misc::value_width<typename T::retType>::value...};
+        std::size_t offset = 0;
+        for(std::size_t i = 0; i < index; i++) {
+            offset += widths[i];
+        }
+        return offset;
+    }
 
-    template <typename Iterator>
-    void operator()(ParserState<Iterator> &state) const {
-        this->left(state);
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<(I < sizeof...(T))> = nullptr>
+    void matchFrom(ParserState<Iterator, Policy> &state, Iterator old, V &value) const {
+        this->matchAt<I>(state, value);
         if(!state.result()) {
-            state.setResult(true);
-            this->right(state);
+            if(I > 0) {
+                state.cursor() = old;
+            }
+            return;
         }
+        this->matchFrom<I + 1>(state, old, value);
     }
-};
-
-template <typename L, typename R>
-struct Choice : BinaryExpr<L, R> {
-    using leftType = typename L::retType;
-    using rightType = typename R::retType;
 
-    static_assert(std::is_assignable<leftType, rightType >::value, "must be assignable");
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<I == sizeof...(T)> = nullptr>
+    void matchFrom(ParserState<Iterator, Policy> &, Iterator, V &) const { }
 
-    using retType = leftType;
+    template <std::size_t I, typename Iterator, typename Policy,
+            misc::enable_when<(I < sizeof...(T))> = nullptr>
+    MatchResult<Iterator> matchFrom(Iterator cursor, Iterator old, ParserState<Iterator, Policy> &state) const {
+        auto r = std::get<I>(this->exprs).match(cursor, state);
+        if(!r.success) {
+            return {I > 0 ? old : r.pos, false};
+        }
+        return this->matchFrom<I + 1>(r.pos, old, state);
+    }
 
-    constexpr Choice(L left, R right) : BinaryExpr<L, R>(left, right) { }
+    template <std::size_t I, typename Iterator, typename Policy,
+            misc::enable_when<I == sizeof...(T)> = nullptr>
+    MatchResult<Iterator> matchFrom(Iterator cursor, Iterator, ParserState<Iterator, Policy> &) const {
+        return {cursor, true};
+    }
 
-    template <typename Iterator>
-    auto operator()(ParserState<Iterator> &state) const {
-        retType v = this->left(state);
-        if(!state.result()) {
-            state.setResult(true);
-            v = this->right(state);
+    /**
+     * at least min length of input remains. if fixed width, following expressions are matched without bounds check.
+     * first expression is matched as usual, since most of mismatches are found by it
+     */
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value && fixedWidth()> = nullptr>
+    MatchResult<Iterator> matchEnough(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        auto r = std::get<0>(this->exprs).match(cursor, state);
+        if(!r.success) {
+            return r;
         }
-        return v;
+        return this->testFrom<1>(r.pos, cursor, state);
     }
-};
-
-template <typename L, typename R,
-        misc::enable_when<is_expr<L>::value && is_expr<R>::value
-                          && std::is_void<typename L::retType>::value
-                          && std::is_void<typename R::retType>::value> = nullptr>
-constexpr auto choiceHelper(L left, R right) {
-    return ChoiceVoid<L, R>(left, right);
-}
 
-template <typename L, typename R,
-        misc::enable_when<is_expr<L>::value && is_expr<R>::value
-                          && !std::is_void<typename L::retType>::value
-                          && !std::is_void<typename R::retType>::value> = nullptr>
-constexpr auto choiceHelper(L left, R right) {
-    return Choice<L, R>(left, right);
-}
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value && !fixedWidth()> = nullptr>
+    MatchResult<Iterator> matchEnough(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        return this->matchFrom<0>(cursor, cursor, state);
+    }
 
-template <typename T>
-struct NonTerminal : Expression {
-    using retType = misc::param_type_of_t<T>;
+    /**
+     * same as matchFrom(), but mismatched expression is matched again for failure report
+     */
+    template <std::size_t I, typename Iterator, typename Policy,
+            misc::enable_when<(I < sizeof...(T))> = nullptr>
+    MatchResult<Iterator> testFrom(Iterator cursor, Iterator old, ParserState<Iterator, Policy> &state) const {
+        if(!std::get<I>(this->exprs).test(cursor)) {
+            auto r = std::get<I>(this->exprs).match(cursor, state);
+            return {I > 0 ? old : r.pos, false};
+        }
+        return this->testFrom<I + 1>(cursor + std::get<I>(this->exprs).width(), old, state);
+    }
 
-    constexpr NonTerminal() {}  //NOLINT
+    template <std::size_t I, typename Iterator, typename Policy,
+            misc::enable_when<I == sizeof...(T)> = nullptr>
+    MatchResult<Iterator> testFrom(Iterator cursor, Iterator, ParserState<Iterator, Policy> &) const {
+        return {cursor, true};
+    }
 
-    template <typename Iterator, typename P = retType,
-            misc::enable_when<!std::is_void<P>::value> = nullptr>
-    auto operator()(ParserState<Iterator> &state) const {
-        constexpr auto p = T::pattern();
-        return p(state);
+    template <std::size_t I, typename Iterator, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    bool testFrom(Iterator cursor) const {
+        return std::get<I>(this->exprs).test(cursor) &&
+               this->testFrom<I + 1>(cursor + std::get<I>(this->exprs).width());
     }
 
-    template <typename Iterator, typename P = retType,
+    template <std::size_t I, typename Iterator, misc::enable_when<I == sizeof...(T)> = nullptr>
+    bool testFrom(Iterator) const {
+        return true;
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<std::is_void<exprType<I>>::value> = nullptr>
+    void matchAt(ParserState<Iterator, Policy> &state, V &) const {
+        std::get<I>(this->exprs)(state);
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<!std::is_void<exprType<I>>::value && singleValue()> = nullptr>
+    void matchAt(ParserState<Iterator, Policy> &state, V &value) const {
+        value = std::get<I>(this->exprs)(state);
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<!std::is_void<exprType<I>>::value && !singleValue()
+                              && !misc::is_tuple<exprType<I>>::value> = nullptr>
+    void matchAt(ParserState<Iterator, Policy> &state, V &value) const {
+        std::get<offsetOf(I)>(value) = std::get<I>(this->exprs)(state);
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<!singleValue() && misc::is_tuple<exprType<I>>::value> = nullptr>
+    void matchAt(ParserState<Iterator, Policy> &state, V &value) const {
+        moveTo<offsetOf(I)>(value, std::get<I>(this->exprs)(state),
+                            std::make_index_sequence<std::tuple_size<exprType<I>>::value>());
+    }
+
+    template <std::size_t Offset, typename V, typename ... A, std::size_t ... J>
+    static void moveTo(V &value, std::tuple<A ...> &&v, std::index_sequence<J ...>) {
+        using expander = int[];
+        (void) expander{0, (std::get<Offset + J>(value) = std::move(std::get<J>(v)), 0)...};
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr unicode_util::ByteMap firstSetFrom() const {
+        return std::get<I>(this->exprs).nullable() ?
+               std::get<I>(this->exprs).firstSet() + this->firstSetFrom<I + 1>() :
+               std::get<I>(this->exprs).firstSet();
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr unicode_util::ByteMap firstSetFrom() const {
+        return unicode_util::ByteMap();
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr bool nullableFrom() const {
+        return std::get<I>(this->exprs).nullable() && this->nullableFrom<I + 1>();
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr bool nullableFrom() const {
+        return true;
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr std::size_t minLengthFrom() const {
+        return addLength(std::get<I>(this->exprs).minLength(), this->minLengthFrom<I + 1>());
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr std::size_t minLengthFrom() const {
+        return 0;
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr std::size_t maxLengthFrom() const {
+        return addLength(std::get<I>(this->exprs).maxLength(), this->maxLengthFrom<I + 1>());
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr std::size_t maxLengthFrom() const {
+        return 0;
+    }
+};
+
+template <typename T>
+struct is_sequence : misc::is_specialization_of<T, Sequence> { };
+
+template <typename T, misc::enable_when<!is_sequence<T>::value> = nullptr>
+constexpr auto asSequenceElements(T expr) {
+    return std::make_tuple(expr);
+}
+
+template <typename ... T>
+constexpr auto asSequenceElements(Sequence<T ...> expr) {
+    return expr.exprs;
+}
+
+template <typename ... T>
+constexpr auto makeSequence(std::tuple<T ...> exprs) {
+    return Sequence<T ...>(exprs);
+}
+
+/**
+ * if all elements are fused into one, not wrap it
+ */
+template <typename T>
+constexpr auto makeSequence(std::tuple<T> exprs) {
+    return std::get<0>(exprs);
+}
+
+// peephole rewrite of adjacent sequence elements. fuseSeq(left, right) is defined only for fusible pair
+
+constexpr CharString<1> toCharString(Char ch) {
+    CharString<1> str;
+    str.text[0] = ch.ch;
+    return str;
+}
+
+/**
+ * sequence of Char => CharString
+ */
+constexpr auto fuseSeq(Char left, Char right) {
+    return toCharString(left) + toCharString(right);
+}
+
+template <std::size_t N>
+constexpr auto fuseSeq(CharString<N> left, Char right) {
+    return left + toCharString(right);
+}
+
+template <std::size_t N>
+constexpr auto fuseSeq(Char left, CharString<N> right) {
+    return toCharString(left) + right;
+}
+
+template <std::size_t N, std::size_t M>
+constexpr auto fuseSeq(CharString<N> left, CharString<M> right) {
+    return left + right;
+}
+
+/**
+ * !set(X) >> ANY => negated CharClass
+ */
+constexpr auto fuseSeq(NotPredicate<CharClass> left, Any) {
+    return CharClass(unicode_util::AsciiMap(~left.expr.asciiMap.map[0], ~left.expr.asciiMap.map[1]));
+}
+
+constexpr auto fuseSeq(NotPredicate<Char> left, Any) {
+    return fuseSeq(NotPredicate<CharClass>(CharClass(unicode_util::AsciiMap() + left.expr.ch)), Any());
+}
+
+template <typename L, typename R>
+constexpr auto isSeqFusible(int) -> decltype(fuseSeq(std::declval<L>(), std::declval<R>()), true) {
+    return true;
+}
+
+template <typename L, typename R>
+constexpr bool isSeqFusible(long) {
+    return false;
+}
+
+template <typename ... L, typename ... R,
+        misc::enable_when<isSeqFusible<typename std::tuple_element<sizeof...(L) - 1, std::tuple<L ...>>::type,
+                                       misc::first_of_param_pack_t<R ...>>(0)> = nullptr>
+constexpr auto joinSequenceElements(std::tuple<L ...> left, std::tuple<R ...> right) {
+    return std::tuple_cat(misc::sliceTuple<0, sizeof...(L) - 1>(left),
+                          std::make_tuple(fuseSeq(std::get<sizeof...(L) - 1>(left), std::get<0>(right))),
+                          misc::sliceTuple<1, sizeof...(R)>(right));
+}
+
+template <typename ... L, typename ... R,
+        misc::enable_when<!isSeqFusible<typename std::tuple_element<sizeof...(L) - 1, std::tuple<L ...>>::type,
+                                        misc::first_of_param_pack_t<R ...>>(0)> = nullptr>
+constexpr auto joinSequenceElements(std::tuple<L ...> left, std::tuple<R ...> right) {
+    return std::tuple_cat(left, right);
+}
+
+template <typename L, typename R,
+        misc::enable_when<is_expr<L>::value && is_expr<R>::value> = nullptr>
+constexpr auto seqHelper(L left, R right) {
+    return makeSequence(joinSequenceElements(asSequenceElements(left), asSequenceElements(right)));
+}
+
+
+/**
+ * bytes which expression can start with.
+ */
+struct StartSet {
+    /**
+     * if expression is nullable, contains all bytes
+     */
+    unicode_util::ByteMap map;
+
+    /**
+     * if true, expression may match at end of input
+     */
+    bool nullable;
+
+    template <typename T>
+    constexpr explicit StartSet(const T &expr) :
+            map(expr.nullable() ? unicode_util::ByteMap::full() : expr.firstSet()), nullable(expr.nullable()) { }
+
+    /**
+     *
+     * @param state
+     * @return
+     * if false, expression never matches at current position
+     */
+    template <typename Iterator, typename Policy>
+    bool accept(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        return cursor == state.end() ? this->nullable : this->map.contains(static_cast<unsigned char>(*cursor));
+    }
+};
+
+template <std::size_t N>
+struct ChoiceTable {
+    static_assert(N < 256, "too many alternatives");
+
+    StartSet sets[N];
+
+    /**
+     * index of first alternative which can start with next byte. last entry is for end of input.
+     * if there is no such alternative, N
+     */
+    unsigned char start[257];
+};
+
+/**
+ * flattened ordered choice (a | b | c ...).
+ * first alternative which can start with next byte is selected by table, and the others are tried in order
+ * after checking next byte by their first byte set.
+ * skipped alternative reports failure at current position instead, so order of alternatives is kept
+ * even if first byte sets are overlapped.
+ */
+template <typename ... T>
+struct Choice : NaryExpr<T ...> {
+    using retType = typename misc::first_of_param_pack_t<T ...>::retType;
+
+    static_assert(misc::allOf({std::is_void<typename T::retType>::value...}) ||
+                  misc::allOf({!std::is_void<typename T::retType>::value...}), "must be same kind of type");
+
+    static_assert(std::is_void<retType>::value ||
+                  misc::allOf({std::is_assignable<retType, typename T::retType>::value...}), "must be assignable");
+
+    ChoiceTable<sizeof...(T)> table;
+
+    constexpr explicit Choice(std::tuple<T ...> exprs) :
+            NaryExpr<T ...>(exprs), table(makeTable(exprs, std::index_sequence_for<T ...>())) { }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<!std::is_void<P>::value> = nullptr>
+    retType operator()(ParserState<Iterator, Policy> &state) const {
+        retType value = retType();
+        const unsigned int start = this->startIndex(state.cursor(), state);
+        if(start > 0) {
+            state.reportFailure();
+            state.setResult(true);
+        }
+        this->matchFrom<0>(state, start, value);
+        return value;
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        const unsigned int start = this->startIndex(cursor, state);
+        if(start > 0) {
+            state.reportFailureAt(cursor);
+        }
+        return this->matchFrom<0>(cursor, start, state);
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->firstSetFrom<0>();
+    }
+
+    constexpr bool nullable() const {
+        for(auto &e : this->table.sets) {
+            if(e.nullable) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->minLengthFrom<0>();
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->maxLengthFrom<0>();
+    }
+
+private:
+    template <std::size_t ... I>
+    static constexpr ChoiceTable<sizeof...(T)> makeTable(const std::tuple<T ...> &exprs, std::index_sequence<I ...>) {
+        ChoiceTable<sizeof...(T)> table{{StartSet(std::get<I>(exprs))...}, {}};
+        for(unsigned int b = 0; b < 257; b++) {
+            unsigned int index = 0;
+            for(; index < sizeof...(T); index++) {
+                const StartSet &set = table.sets[index];
+                if(b == 256 ? set.nullable : set.map.contains(static_cast<unsigned char>(b))) {
+                    break;
+                }
+            }
+            table.start[b] = static_cast<unsigned char>(index);
+        }
+        return table;
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr unicode_util::ByteMap firstSetFrom() const {
+        return std::get<I>(this->exprs).firstSet() + this->firstSetFrom<I + 1>();
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr unicode_util::ByteMap firstSetFrom() const {
+        return unicode_util::ByteMap();
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr std::size_t minLengthFrom() const {
+        const std::size_t size = std::get<I>(this->exprs).minLength();
+        const std::size_t rest = this->minLengthFrom<I + 1>();
+        return size < rest ? size : rest;
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr std::size_t minLengthFrom() const {
+        return INFINITE_LENGTH;
+    }
+
+    template <std::size_t I, misc::enable_when<(I < sizeof...(T))> = nullptr>
+    constexpr std::size_t maxLengthFrom() const {
+        const std::size_t size = std::get<I>(this->exprs).maxLength();
+        const std::size_t rest = this->maxLengthFrom<I + 1>();
+        return size > rest ? size : rest;
+    }
+
+    template <std::size_t I, misc::enable_when<I == sizeof...(T)> = nullptr>
+    constexpr std::size_t maxLengthFrom() const {
+        return 0;
+    }
+
+    /**
+     *
+     * @param cursor
+     * @param state
+     * @return
+     * index of first alternative which may match. if greater than 0, caller must report failure
+     * of skipped alternatives
+     */
+    template <typename Iterator, typename Policy>
+    unsigned int startIndex(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        return this->table.start[cursor == state.end() ? 256u : static_cast<unsigned char>(*cursor)];
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<(I + 1 < sizeof...(T))> = nullptr>
+    void matchFrom(ParserState<Iterator, Policy> &state, unsigned int start, V &value) const {
+        if(I >= start) {
+            if(I == start || this->table.sets[I].accept(state.cursor(), state)) {
+                this->matchAt<I>(state, value);
+                if(state.result()) {
+                    return;
+                }
+            } else {
+                state.reportFailureAt(state.cursor(), std::get<I>(this->exprs));
+            }
+            state.setResult(true);
+        } else if(Policy::trackExpected) {   // skipped by table
+            state.reportFailureAt(state.cursor(), std::get<I>(this->exprs));
+        }
+        this->matchFrom<I + 1>(state, start, value);
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V,
+            misc::enable_when<I + 1 == sizeof...(T)> = nullptr>
+    void matchFrom(ParserState<Iterator, Policy> &state, unsigned int start, V &value) const {
+        if(I >= start && (I == start || this->table.sets[I].accept(state.cursor(), state))) {
+            this->matchAt<I>(state, value);
+        } else {
+            state.reportFailureAt(state.cursor(), std::get<I>(this->exprs));
+            state.setResult(false);
+        }
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy, typename V>
+    void matchAt(ParserState<Iterator, Policy> &state, V &value) const {
+        ArenaGuard<Policy> guard(state);
+        value = std::get<I>(this->exprs)(state);
+        guard.rollbackIfFailed(state);
+    }
+
+    /**
+     * for void type. cursor is not restored between alternatives (same as value type)
+     */
+    template <std::size_t I, typename Iterator, typename Policy,
+            misc::enable_when<(I + 1 < sizeof...(T))> = nullptr>
+    MatchResult<Iterator> matchFrom(Iterator cursor, unsigned int start, ParserState<Iterator, Policy> &state) const {
+        if(I >= start) {
+            if(I == start || this->table.sets[I].accept(cursor, state)) {
+                auto r = std::get<I>(this->exprs).match(cursor, state);
+                if(r.success) {
+                    return r;
+                }
+                cursor = r.pos;
+            } else {
+                state.reportFailureAt(cursor, std::get<I>(this->exprs));
+            }
+        } else if(Policy::trackExpected) {   // skipped by table
+            state.reportFailureAt(cursor, std::get<I>(this->exprs));
+        }
+        return this->matchFrom<I + 1>(cursor, start, state);
+    }
+
+    template <std::size_t I, typename Iterator, typename Policy,
+            misc::enable_when<I + 1 == sizeof...(T)> = nullptr>
+    MatchResult<Iterator> matchFrom(Iterator cursor, unsigned int start, ParserState<Iterator, Policy> &state) const {
+        if(I >= start && (I == start || this->table.sets[I].accept(cursor, state))) {
+            return std::get<I>(this->exprs).match(cursor, state);
+        }
+        state.reportFailureAt(cursor, std::get<I>(this->exprs));
+        return {cursor, false};
+    }
+};
+
+template <typename T>
+struct is_choice : misc::is_specialization_of<T, Choice> { };
+
+template <typename T, misc::enable_when<!is_choice<T>::value> = nullptr>
+constexpr auto asChoiceElements(T expr) {
+    return std::make_tuple(expr);
+}
+
+template <typename ... T>
+constexpr auto asChoiceElements(Choice<T ...> expr) {
+    return expr.exprs;
+}
+
+template <typename ... T>
+constexpr auto makeChoice(std::tuple<T ...> exprs) {
+    return Choice<T ...>(exprs);
+}
+
+template <typename T>
+constexpr auto makeChoice(std::tuple<T> exprs) {
+    return std::get<0>(exprs);
+}
+
+template <typename T>
+struct NonTerminal;
+
+// structural equality of expressions. unknown expression (ex. mapper) is conservatively treated as different one
+
+template <typename T>
+constexpr bool sameExpr(const T &, const T &) {
+    return false;
+}
+
+constexpr bool sameExpr(const Empty &, const Empty &) {
+    return true;
+}
+
+constexpr bool sameExpr(const Any &, const Any &) {
+    return true;
+}
+
+constexpr bool sameExpr(const Utf8Any &, const Utf8Any &) {
+    return true;
+}
+
+constexpr bool sameExpr(const StringLiteral &x, const StringLiteral &y) {
+    if(x.size != y.size) {
+        return false;
+    }
+    for(unsigned int i = 0; i < x.size; i++) {
+        if(x.text[i] != y.text[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <std::size_t N>
+constexpr bool sameExpr(const CharString<N> &x, const CharString<N> &y) {
+    for(std::size_t i = 0; i < N; i++) {
+        if(x.text[i] != y.text[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool sameExpr(const Char &x, const Char &y) {
+    return x.ch == y.ch;
+}
+
+constexpr bool sameExpr(const Utf8Char &x, const Utf8Char &y) {
+    return x.ch == y.ch;
+}
+
+constexpr bool sameExpr(const CharClass &x, const CharClass &y) {
+    return x.asciiMap.map[0] == y.asciiMap.map[0] && x.asciiMap.map[1] == y.asciiMap.map[1];
+}
+
+constexpr bool sameExpr(const Utf8CharClass &x, const Utf8CharClass &y) {
+    if(x.size != y.size) {
+        return false;
+    }
+    for(std::size_t i = 0; i < x.size; i++) {
+        if(x.text[i] != y.text[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool sameExpr(const SkipUntil &x, const SkipUntil &y) {
+    for(unsigned int i = 0; i < 4; i++) {
+        if(x.delims.bytes[i] != y.delims.bytes[i]) {
+            return false;
+        }
+    }
+    return x.delims.size == y.delims.size;
+}
+
+template <typename T, typename D, size_t Low, size_t High>
+constexpr bool sameRepeat(const RepeatBase<T, D, Low, High> &x, const RepeatBase<T, D, Low, High> &y) {
+    return sameExpr(x.expr, y.expr) && sameExpr(x.delim, y.delim);
+}
+
+template <typename T, size_t Low, size_t High>
+constexpr bool sameRepeat(const RepeatBase<T, Empty, Low, High> &x, const RepeatBase<T, Empty, Low, High> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T, typename D, size_t Low, size_t High>
+constexpr bool sameExpr(const RepeatVoid<T, D, Low, High> &x, const RepeatVoid<T, D, Low, High> &y) {
+    return sameRepeat(x, y);
+}
+
+template <typename T, typename D, size_t Low, size_t High>
+constexpr bool sameExpr(const Repeat<T, D, Low, High> &x, const Repeat<T, D, Low, High> &y) {
+    return sameRepeat(x, y);
+}
+
+template <typename T, size_t N>
+constexpr bool sameExpr(const RepeatFixed<T, N> &x, const RepeatFixed<T, N> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T>
+constexpr bool sameExpr(const OptionVoid<T> &x, const OptionVoid<T> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T>
+constexpr bool sameExpr(const Option<T> &x, const Option<T> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T>
+constexpr bool sameExpr(const NotPredicate<T> &x, const NotPredicate<T> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T>
+constexpr bool sameExpr(const Capture<T> &x, const Capture<T> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T>
+constexpr bool sameExpr(const ViewCapture<T> &x, const ViewCapture<T> &y) {
+    return sameExpr(x.expr, y.expr);
+}
+
+template <typename T>
+constexpr bool sameExpr(const NonTerminal<T> &, const NonTerminal<T> &) {
+    return true;
+}
+
+template <typename ... T, std::size_t ... I>
+constexpr bool sameElements(const std::tuple<T ...> &x, const std::tuple<T ...> &y, std::index_sequence<I ...>) {
+    return misc::allOf({sameExpr(std::get<I>(x), std::get<I>(y))...});
+}
+
+template <typename ... T>
+constexpr bool sameExpr(const Sequence<T ...> &x, const Sequence<T ...> &y) {
+    return sameElements(x.exprs, y.exprs, std::index_sequence_for<T ...>());
+}
+
+template <typename ... T>
+constexpr bool sameExpr(const Choice<T ...> &x, const Choice<T ...> &y) {
+    return sameElements(x.exprs, y.exprs, std::index_sequence_for<T ...>());
+}
+
+/**
+ * alternative of factored suffix. cursor is restored on failure, so next alternative starts at end of
+ * shared prefix (same as sequence of prefix and alternative).
+ */
+template <typename T>
+struct RestoreOnFailure : UnaryExpr<T> {
+    using retType = typename T::retType;
+
+    constexpr explicit RestoreOnFailure(T expr) : UnaryExpr<T>(expr) { }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<!std::is_void<P>::value> = nullptr>
+    retType operator()(ParserState<Iterator, Policy> &state) const {
+        auto old = state.cursor();
+        retType value = this->expr(state);
+        if(!state.result()) {
+            state.cursor() = old;
+        }
+        return value;
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        auto r = this->expr.match(cursor, state);
+        if(!r.success) {
+            return {cursor, false};
+        }
+        return r;
+    }
+};
+
+/**
+ * left factored choice (p >> a | p >> b => p >> (a | b)). prefix is matched only once.
+ * built from adjacent alternatives which have same prefix in type (see fuseChoice). if prefixes are different
+ * in value, original choice is used instead.
+ * each alternative of suffix starts at end of prefix. if prefix fails after consuming input,
+ * original choice is matched again, since following alternatives start at where prefix left cursor.
+ * @tparam P
+ * shared prefix. must be void type
+ * @tparam S
+ * choice of remaining part of alternatives
+ * @tparam C
+ * original choice
+ */
+template <typename P, typename S, typename C>
+struct FactoredChoice : Expression {
+    static_assert(std::is_void<typename P::retType>::value, "must be void type");
+
+    using retType = typename C::retType;
+
+    P prefix;
+
+    S suffix;
+
+    C choice;
+
+    /**
+     * if true, prefixes are same in value
+     */
+    bool shared;
+
+    constexpr FactoredChoice(P prefix, S suffix, C choice, bool shared) :
+            prefix(prefix), suffix(suffix), choice(choice), shared(shared) { }
+
+    template <typename Iterator, typename Policy, typename Q = retType,
+            misc::enable_when<std::is_void<Q>::value> = nullptr>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy, typename Q = retType,
+            misc::enable_when<!std::is_void<Q>::value> = nullptr>
+    retType operator()(ParserState<Iterator, Policy> &state) const {
+        if(!this->shared) {
+            return this->choice(state);
+        }
+        retType value = retType();
+        auto old = state.cursor();
+        this->prefix(state);
+        if(!state.result()) {
+            if(state.cursor() != old) {   // following alternatives start at where prefix left cursor
+                state.cursor() = old;
+                state.setResult(true);
+                return this->choice(state);
+            }
+            return value;
+        }
+        value = this->suffix(state);
+        if(!state.result()) {
+            state.cursor() = old;
+        }
+        return value;
+    }
+
+    /**
+     * same as sequence of prefix and suffix
+     */
+    template <typename Iterator, typename Policy, typename Q = retType,
+            misc::enable_when<std::is_void<Q>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(!this->shared) {
+            return this->choice.match(cursor, state);
+        }
+        auto r = this->prefix.match(cursor, state);
+        if(!r.success) {
+            if(r.pos != cursor) {   // following alternatives start at where prefix left cursor
+                return this->choice.match(cursor, state);
+            }
+            return r;
+        }
+        r = this->suffix.match(r.pos, state);
+        if(!r.success) {
+            return {cursor, false};
+        }
+        return r;
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->choice.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return this->choice.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->choice.minLength();
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->choice.maxLength();
+    }
+};
+
+/**
+ * number of leading elements which are same type and void type. value of prefix is not supported
+ */
+template <typename L, typename R, typename = void>
+struct common_prefix_size : std::integral_constant<std::size_t, 0> { };
+
+template <typename H, typename ... L, typename ... R>
+struct common_prefix_size<std::tuple<H, L ...>, std::tuple<H, R ...>,
+        std::enable_if_t<std::is_void<typename H::retType>::value>> :
+        std::integral_constant<std::size_t, 1 + common_prefix_size<std::tuple<L ...>, std::tuple<R ...>>::value> { };
+
+/**
+ * single token. re-matching of it is cheap, and alternatives starting with same kind of token
+ * are usually different in value (ex. keywords), so they are not factored.
+ */
+template <typename T>
+struct is_token : std::integral_constant<bool,
+        std::is_same<T, Any>::value || std::is_same<T, Utf8Any>::value || std::is_same<T, Empty>::value ||
+        std::is_same<T, Char>::value || std::is_same<T, Utf8Char>::value || std::is_same<T, CharClass>::value ||
+        std::is_same<T, Utf8CharClass>::value || std::is_same<T, StringLiteral>::value> { };
+
+template <std::size_t N>
+struct is_token<CharString<N>> : std::true_type { };
+
+/**
+ * if true, cursor is left at start position on failure. unknown expression is conservatively treated as not.
+ */
+template <typename T>
+struct restores_cursor : is_token<T> { };
+
+template <typename H, typename ... T>
+struct restores_cursor<Sequence<H, T ...>> : restores_cursor<H> { };  // only first expression may leave cursor
+
+template <typename ... T>
+struct restores_cursor<Choice<T ...>> : std::integral_constant<bool, misc::allOf({restores_cursor<T>::value...})> { };
+
+template <typename T>
+struct restores_cursor<RestoreOnFailure<T>> : std::true_type { };
+
+template <typename P, typename S, typename C>
+struct restores_cursor<FactoredChoice<P, S, C>> :
+        std::integral_constant<bool, restores_cursor<P>::value && restores_cursor<C>::value> { };
+
+template <typename T, misc::enable_when<restores_cursor<T>::value> = nullptr>
+constexpr auto restoreOnFailure(T expr) {
+    return expr;
+}
+
+template <typename T, misc::enable_when<!restores_cursor<T>::value> = nullptr>
+constexpr auto restoreOnFailure(T expr) {
+    return RestoreOnFailure<T>(expr);
+}
+
+/**
+ * memoized rule. re-matching of it is memo table lookup, so it is not factored like token
+ */
+template <typename T>
+struct is_memo_nterm : std::false_type { };
+
+template <typename T>
+struct is_memo_nterm<NonTerminal<T>> : misc::is_memo_rule<T> { };
+
+/**
+ *
+ * @tparam T
+ * sequence elements
+ * @tparam I
+ * indices of common prefix
+ * @return
+ * size of prefix which is worth factoring. trailing tokens and memoized rules of common prefix are excluded
+ */
+template <typename ... T, std::size_t ... I>
+constexpr std::size_t factorablePrefixSize(std::index_sequence<I ...>) {
+    const bool tokens[] = {true, (is_token<typename std::tuple_element<I, std::tuple<T ...>>::type>::value ||
+                                  is_memo_nterm<typename std::tuple_element<I, std::tuple<T ...>>::type>::value)...};
+    std::size_t size = sizeof...(I);
+    for(; size > 0 && tokens[size]; size--);
+    return size;
+}
+
+template <typename L, typename R>
+struct factor_size;
+
+/**
+ * number of leading sequence elements which are shared by alternatives in type. if not factorable, 0
+ */
+template <typename ... L, typename ... R>
+struct factor_size<std::tuple<L ...>, std::tuple<R ...>> {
+    static constexpr std::size_t common = common_prefix_size<std::tuple<L ...>, std::tuple<R ...>>::value;
+
+    static constexpr std::size_t prefix = factorablePrefixSize<L ...>(std::make_index_sequence<common>());
+
+    /**
+     * value type alternative must have non-empty suffix
+     */
+    static constexpr bool hasSuffix = misc::allOf({std::is_void<typename R::retType>::value...}) ||
+                                      (prefix < sizeof...(L) && prefix < sizeof...(R));
+
+    static constexpr std::size_t value = prefix > 0 && hasSuffix ? prefix : 0;
+};
+
+template <typename L, typename R>
+using factor_size_of = factor_size<decltype(asSequenceElements(std::declval<L>())),
+                                   decltype(asSequenceElements(std::declval<R>()))>;
+
+template <std::size_t K, typename ... T>
+constexpr auto prefixOf(const std::tuple<T ...> &exprs) {
+    return makeSequence(misc::sliceTuple<0, K>(exprs));
+}
+
+template <std::size_t K, typename ... T, misc::enable_when<K == sizeof...(T)> = nullptr>
+constexpr auto suffixOf(const std::tuple<T ...> &) {
+    return Empty();
+}
+
+template <std::size_t K, typename ... T, misc::enable_when<(K < sizeof...(T))> = nullptr>
+constexpr auto suffixOf(const std::tuple<T ...> &exprs) {
+    return makeSequence(misc::sliceTuple<K, sizeof...(T)>(exprs));
+}
+
+template <typename ... L, typename ... R, std::size_t ... I>
+constexpr bool samePrefix(const std::tuple<L ...> &x, const std::tuple<R ...> &y, std::index_sequence<I ...>) {
+    return misc::allOf({sameExpr(std::get<I>(x), std::get<I>(y))...});
+}
+
+template <typename P, typename S, typename C>
+constexpr auto makeFactoredChoice(P prefix, S suffix, C choice, bool shared) {
+    return FactoredChoice<P, S, C>(prefix, suffix, choice, shared);
+}
+
+// peephole rewrite of adjacent alternatives. fuseChoice(left, right) is defined only for fusible pair
+
+constexpr unicode_util::AsciiMap toAsciiMap(Char ch) {
+    return unicode_util::AsciiMap() + ch.ch;
+}
+
+constexpr unicode_util::AsciiMap toAsciiMap(CharClass set) {
+    return set.asciiMap;
+}
+
+/**
+ * choice of Char/CharClass => CharClass. adjacent single byte alternatives can be merged regardless of order
+ */
+template <typename L, typename R,
+        misc::enable_when<(std::is_same<L, Char>::value || std::is_same<L, CharClass>::value) &&
+                          (std::is_same<R, Char>::value || std::is_same<R, CharClass>::value)> = nullptr>
+constexpr auto fuseChoice(L left, R right) {
+    return CharClass(toAsciiMap(left) + toAsciiMap(right));
+}
+
+/**
+ * p >> a | p >> b => p >> (a | b)
+ */
+template <typename L, typename R, std::size_t K = factor_size_of<L, R>::value,
+        misc::enable_when<(K > 0)> = nullptr>
+constexpr auto fuseChoice(L left, R right) {
+    return makeFactoredChoice(prefixOf<K>(asSequenceElements(left)),
+                              choiceHelper(restoreOnFailure(suffixOf<K>(asSequenceElements(left))),
+                                           restoreOnFailure(suffixOf<K>(asSequenceElements(right)))),
+                              makeChoice(std::make_tuple(left, right)),
+                              samePrefix(asSequenceElements(left), asSequenceElements(right),
+                                         std::make_index_sequence<K>()));
+}
+
+/**
+ * (p >> a | p >> b) | p >> c => p >> (a | b | c)
+ */
+template <typename P, typename S, typename C, typename R,
+        std::size_t K = std::tuple_size<decltype(asSequenceElements(std::declval<P>()))>::value,
+        misc::enable_when<factor_size_of<P, R>::common == K &&
+                          (std::is_void<typename R::retType>::value ||
+                           K < std::tuple_size<decltype(asSequenceElements(std::declval<R>()))>::value)> = nullptr>
+constexpr auto fuseChoice(FactoredChoice<P, S, C> left, R right) {
+    return makeFactoredChoice(left.prefix,
+                              choiceHelper(left.suffix,
+                                           restoreOnFailure(suffixOf<K>(asSequenceElements(right)))),
+                              makeChoice(std::tuple_cat(left.choice.exprs, std::make_tuple(right))),
+                              left.shared && samePrefix(asSequenceElements(left.prefix), asSequenceElements(right),
+                                                        std::make_index_sequence<K>()));
+}
+
+template <typename L, typename R>
+constexpr auto isChoiceFusible(int) -> decltype(fuseChoice(std::declval<L>(), std::declval<R>()), true) {
+    return true;
+}
+
+template <typename L, typename R>
+constexpr bool isChoiceFusible(long) {
+    return false;
+}
+
+template <typename ... L, typename ... R,
+        misc::enable_when<isChoiceFusible<typename std::tuple_element<sizeof...(L) - 1, std::tuple<L ...>>::type,
+                                          misc::first_of_param_pack_t<R ...>>(0)> = nullptr>
+constexpr auto joinChoiceElements(std::tuple<L ...> left, std::tuple<R ...> right) {
+    return std::tuple_cat(misc::sliceTuple<0, sizeof...(L) - 1>(left),
+                          std::make_tuple(fuseChoice(std::get<sizeof...(L) - 1>(left), std::get<0>(right))),
+                          misc::sliceTuple<1, sizeof...(R)>(right));
+}
+
+template <typename ... L, typename ... R,
+        misc::enable_when<!isChoiceFusible<typename std::tuple_element<sizeof...(L) - 1, std::tuple<L ...>>::type,
+                                           misc::first_of_param_pack_t<R ...>>(0)> = nullptr>
+constexpr auto joinChoiceElements(std::tuple<L ...> left, std::tuple<R ...> right) {
+    return std::tuple_cat(left, right);
+}
+
+template <typename L, typename R,
+        misc::enable_when<is_expr<L>::value && is_expr<R>::value
+                          && std::is_void<typename L::retType>::value == std::is_void<typename R::retType>::value> = nullptr>
+constexpr auto choiceHelper(L left, R right) {
+    return makeChoice(joinChoiceElements(asChoiceElements(left), asChoiceElements(right)));
+}
+
+template <typename T>
+struct NonTerminal : Expression {
+    using retType = misc::param_type_of_t<T>;
+
+    static_assert(!misc::is_memo_rule<T>::value || std::is_void<retType>::value,
+                  "memoized rule must be void type");
+
+    constexpr NonTerminal() {}  //NOLINT
+
+    // first byte set of rule is not computed (rule may be declared but not defined yet), so use conservative one
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<!std::is_void<P>::value> = nullptr>
+    auto operator()(ParserState<Iterator, Policy> &state) const {
+        static constexpr auto p = T::pattern();
+        state.template enterRule<T>(state.cursor());
+        auto v = p(state);
+        state.template exitRule<T>(state.cursor(), state.result());
+        return v;
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
             misc::enable_when<std::is_void<P>::value> = nullptr>
-    void operator()(ParserState<Iterator> &state) const {
-        constexpr auto p = T::pattern();
-        p(state);
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value && !misc::is_memo_rule<T>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        static constexpr auto p = T::pattern();
+        state.template enterRule<T>(cursor);
+        auto r = p.match(cursor, state);
+        state.template exitRule<T>(r.pos, r.success);
+        return r;
+    }
+
+    template <typename Iterator, typename Policy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value && misc::is_memo_rule<T>::value> = nullptr>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        state.template enterRule<T>(cursor);
+        auto r = this->matchMemo(cursor, state);
+        state.template exitRule<T>(r.pos, r.success);
+        return r;
+    }
+
+private:
+    template <typename Iterator, typename Policy, misc::enable_when<!Policy::useMemo> = nullptr>
+    MatchResult<Iterator> matchMemo(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        static constexpr auto p = T::pattern();
+        return p.match(cursor, state);
+    }
+
+    template <typename Iterator, typename Policy, misc::enable_when<Policy::useMemo> = nullptr>
+    MatchResult<Iterator> matchMemo(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        static constexpr auto p = T::pattern();
+
+        const auto offset = static_cast<std::size_t>(cursor - state.begin());
+        if(static_cast<std::size_t>(state.end() - state.begin()) > MemoTable::MAX_OFFSET) {
+            return p.match(cursor, state);  // too large input, not memoize
+        }
+
+        const std::uint32_t id = ruleId<T>();
+        auto *entry = state.memoTable().find(id, offset);
+        if(entry != nullptr) {
+            state.updateFailure(state.begin() + entry->failure);
+            return {state.begin() + entry->end, entry->success};
+        }
+
+        auto r = p.match(cursor, state);
+        state.memoTable().insert(id, offset, static_cast<std::uint32_t>(r.pos - state.begin()),
+                                 static_cast<std::uint32_t>(std::distance(state.begin(), state.failure())),
+                                 r.success);
+        return r;
     }
 };
 
 
 // for mapper
 
-struct Mapper {};
+/**
+ * some mapper (ex. Joiner) consumes input, so it has first byte set and length like expression.
+ * default is never consume input.
+ */
+struct Mapper {
+    constexpr unicode_util::ByteMap firstSet() const {
+        return unicode_util::ByteMap();
+    }
+
+    constexpr bool nullable() const {
+        return true;
+    }
+
+    constexpr std::size_t minLength() const {
+        return 0;
+    }
+
+    constexpr std::size_t maxLength() const {
+        return 0;
+    }
+};
 
 template <typename T>
 struct is_mapper : std::is_base_of<Mapper, T> { };
@@ -667,9 +2481,25 @@ struct MapperAdapter : Expression {
 
     constexpr MapperAdapter(T expr, M mapper) : expr(expr), mapper(mapper) { }
 
-    template <typename Iterator, typename P = typename T::retType,
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.nullable() ? this->expr.firstSet() + this->mapper.firstSet() : this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return this->expr.nullable() && this->mapper.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return addLength(this->expr.minLength(), this->mapper.minLength());
+    }
+
+    constexpr std::size_t maxLength() const {
+        return addLength(this->expr.maxLength(), this->mapper.maxLength());
+    }
+
+    template <typename Iterator, typename Policy, typename P = typename T::retType,
             misc::enable_when<std::is_void<P>::value> = nullptr>
-    auto operator()(ParserState<Iterator> &state) const {
+    auto operator()(ParserState<Iterator, Policy> &state) const {
         this->expr(state);
         auto r = retType();
         if(state.result()) {
@@ -678,9 +2508,9 @@ struct MapperAdapter : Expression {
         return r;
     }
 
-    template <typename Iterator, typename P = typename T::retType,
+    template <typename Iterator, typename Policy, typename P = typename T::retType,
             misc::enable_when<!std::is_void<P>::value> = nullptr>
-    auto operator()(ParserState<Iterator> &state) const {
+    auto operator()(ParserState<Iterator, Policy> &state) const {
         auto v = this->expr(state);
         auto r = retType();
         if(state.result()) {
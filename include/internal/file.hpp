@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_FILE_HPP
+#define AQUARIUS_CXX_INTERNAL_FILE_HPP
+
+#include <cstdio>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define AQUARIUS_USE_MMAP
+#endif
+
+#include "misc.hpp"
+
+namespace aquarius {
+
+/**
+ * read only file contents as contiguous char range.
+ * regular file is memory-mapped. otherwise (pipe, tty, etc.), read into buffer.
+ */
+class InputFile : public misc::NonCopyable<InputFile> {
+public:
+    enum Option : unsigned int {
+        NONE = 0,
+
+        /**
+         * prefault all of pages at mapping (MAP_POPULATE)
+         */
+        POPULATE = 1u << 0u,
+
+        /**
+         * hint for transparent huge page (MADV_HUGEPAGE)
+         */
+        HUGE_PAGE = 1u << 1u,
+    };
+
+private:
+    const char *data_;
+
+    std::size_t size_;
+
+    /**
+     * if true, data_ is mapped address
+     */
+    bool mapped_;
+
+    /**
+     * for not mapped file
+     */
+    std::string buffer_;
+
+public:
+    InputFile() : data_(""), size_(0), mapped_(false), buffer_() { }
+
+    InputFile(InputFile &&o) noexcept :
+            data_(o.data_), size_(o.size_), mapped_(o.mapped_), buffer_(std::move(o.buffer_)) {
+        if(!this->mapped_) {
+            this->data_ = this->buffer_.c_str();
+        }
+        o.data_ = "";
+        o.size_ = 0;
+        o.mapped_ = false;
+    }
+
+    ~InputFile() {
+        this->close();
+    }
+
+    InputFile &operator=(InputFile &&o) noexcept {
+        if(this != &o) {
+            this->close();
+            this->size_ = o.size_;
+            this->mapped_ = o.mapped_;
+            this->buffer_ = std::move(o.buffer_);
+            this->data_ = this->mapped_ ? o.data_ : this->buffer_.c_str();
+            o.data_ = "";
+            o.size_ = 0;
+            o.mapped_ = false;
+        }
+        return *this;
+    }
+
+    /**
+     * open and map file. if already opened, close it before.
+     * @param path
+     * @param option
+     * @return
+     * if failed, return false and set errno
+     */
+    bool open(const char *path, unsigned int option = POPULATE) {
+        this->close();
+#ifdef AQUARIUS_USE_MMAP
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0) {
+            return false;
+        }
+        bool s = this->open(fd, option);
+        int old = errno;
+        ::close(fd);
+        errno = old;
+        return s;
+#else
+        (void) option;
+        std::FILE *fp = std::fopen(path, "rb");
+        if(fp == nullptr) {
+            return false;
+        }
+        char buf[64 * 1024];
+        for(std::size_t size; (size = std::fread(buf, 1, sizeof(buf), fp)) > 0;) {
+            this->buffer_.append(buf, size);
+        }
+        bool s = std::ferror(fp) == 0;
+        std::fclose(fp);
+        this->data_ = this->buffer_.c_str();
+        this->size_ = this->buffer_.size();
+        return s;
+#endif
+    }
+
+#ifdef AQUARIUS_USE_MMAP
+    /**
+     * read from file descriptor. file descriptor is not closed.
+     * @param fd
+     * @param option
+     * @return
+     * if failed, return false and set errno
+     */
+    bool open(int fd, unsigned int option = POPULATE) {
+        this->close();
+
+        struct stat st; //NOLINT
+        if(fstat(fd, &st) != 0) {
+            return false;
+        }
+        if(!S_ISREG(st.st_mode)) {
+            return this->readAll(fd);
+        }
+        if(static_cast<unsigned long long>(st.st_size) > static_cast<std::size_t>(-1)) {
+            errno = EFBIG;
+            return false;
+        }
+        const auto size = static_cast<std::size_t>(st.st_size);
+        if(size == 0) {   // may have contents (ex. procfs, sysfs)
+            return this->readAll(fd);
+        }
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if(option & POPULATE) {
+            flags |= MAP_POPULATE;
+        }
+#endif
+        void *addr = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        if(addr == MAP_FAILED) {
+            return this->readAll(fd);   // fallback
+        }
+        madvise(addr, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+        if(option & HUGE_PAGE) {
+            madvise(addr, size, MADV_HUGEPAGE);
+        }
+#endif
+        this->data_ = static_cast<const char *>(addr);
+        this->size_ = size;
+        this->mapped_ = true;
+        return true;
+    }
+#endif
+
+    void close() {
+#ifdef AQUARIUS_USE_MMAP
+        if(this->mapped_) {
+            munmap(const_cast<char *>(this->data_), this->size_);
+        }
+#endif
+        this->data_ = "";
+        this->size_ = 0;
+        this->mapped_ = false;
+        this->buffer_.clear();
+    }
+
+    const char *begin() const {
+        return this->data_;
+    }
+
+    const char *end() const {
+        return this->data_ + this->size_;
+    }
+
+    const char *data() const {
+        return this->data_;
+    }
+
+    std::size_t size() const {
+        return this->size_;
+    }
+
+    bool mapped() const {
+        return this->mapped_;
+    }
+
+private:
+#ifdef AQUARIUS_USE_MMAP
+    bool readAll(int fd) {
+        char buf[64 * 1024];
+        while(true) {
+            ssize_t size = ::read(fd, buf, sizeof(buf));
+            if(size == 0) {
+                break;
+            }
+            if(size < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                int old = errno;
+                this->buffer_.clear();
+                errno = old;
+                return false;
+            }
+            this->buffer_.append(buf, static_cast<std::size_t>(size));
+        }
+        this->data_ = this->buffer_.c_str();
+        this->size_ = this->buffer_.size();
+        return true;
+    }
+#endif
+};
+
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_FILE_HPP
@@ -27,13 +27,13 @@ struct CommonMapper : expression::Mapper {
     using retType = misc::ret_type_of_func_t<Functor>;
     static_assert(!std::is_void<retType>::value, "return type of Functor must not be void");
 
-    template <typename Iterator, typename Value>
-    auto operator()(ParserState<Iterator> &, Value &&v) const {
+    template <typename Iterator, typename Policy, typename Value>
+    auto operator()(ParserState<Iterator, Policy> &, Value &&v) const {
         return misc::unpackAndApply<Functor>(std::forward<Value>(v));
     }
 
-    template <typename Iterator>
-    auto operator()(ParserState<Iterator> &) const {
+    template <typename Iterator, typename Policy>
+    auto operator()(ParserState<Iterator, Policy> &) const {
         return misc::unpackAndApply<Functor>();
     }
 };
@@ -43,17 +43,38 @@ struct Constructor : expression::Mapper {
     using retType = misc::type_of_constructor_t<T>;
     static_assert(!std::is_void<retType>::value, "must not be void");
 
-    template <typename Iterator, typename Value>
-    auto operator()(ParserState<Iterator> &, Value &&v) const {
+    template <typename Iterator, typename Policy, typename Value>
+    auto operator()(ParserState<Iterator, Policy> &, Value &&v) const {
         return misc::unpackAndConstruct<T>(std::forward<Value>(v));
     }
 
-    template <typename Iterator>
-    auto operator()(ParserState<Iterator> &) const {
+    template <typename Iterator, typename Policy>
+    auto operator()(ParserState<Iterator, Policy> &) const {
         return misc::unpackAndConstruct<T>();
     }
 };
 
+/**
+ * construct object in arena of ParserState. require ArenaPolicy
+ * @tparam T
+ */
+template <typename T>
+struct ArenaConstructor : expression::Mapper {
+    using retType = ArenaPtr<T>;
+
+    template <typename Iterator, typename Policy, typename Value>
+    auto operator()(ParserState<Iterator, Policy> &state, Value &&v) const {
+        static_assert(Policy::useArena, "require ArenaPolicy");
+        return misc::unpackAndCreate<T>(state.policy().arena(), std::forward<Value>(v));
+    }
+
+    template <typename Iterator, typename Policy>
+    auto operator()(ParserState<Iterator, Policy> &state) const {
+        static_assert(Policy::useArena, "require ArenaPolicy");
+        return state.policy().arena().template create<T>();
+    }
+};
+
 template <typename T>
 struct Supplier : expression::Mapper {
     using retType = T;
@@ -63,8 +84,8 @@ struct Supplier : expression::Mapper {
 
     constexpr explicit Supplier(T constant) : constant(constant) { }
 
-    template <typename Iterator>
-    auto operator()(ParserState<Iterator> &) const {
+    template <typename Iterator, typename Policy>
+    auto operator()(ParserState<Iterator, Policy> &) const {
         return this->constant;
     }
 };
@@ -73,8 +94,8 @@ template <typename T>
 struct NullSupplier : expression::Mapper {
     using retType = std::unique_ptr<T>;
 
-    template <typename Iterator>
-    auto operator()(ParserState<Iterator> &) const {
+    template <typename Iterator, typename Policy>
+    auto operator()(ParserState<Iterator, Policy> &) const {
         return std::unique_ptr<T>();
     }
 };
@@ -91,8 +112,8 @@ template <typename T, typename C = Convertible<T>>
 struct Cast : expression::Mapper {
     using retType = std::unique_ptr<T>;
 
-    template <typename Iterator, typename U>
-    auto operator()(ParserState<Iterator> &state, std::unique_ptr<U> &&value) const {
+    template <typename Iterator, typename Policy, typename U>
+    auto operator()(ParserState<Iterator, Policy> &state, std::unique_ptr<U> &&value) const {
         static_assert(std::is_base_of<T, U>::value || std::is_base_of<U, T>::value, "must be base type of derived type");
         if(!C()(*value.get())) {
             state.setResult(false);
@@ -102,6 +123,27 @@ struct Cast : expression::Mapper {
     }
 };
 
+template <typename T>
+struct Convertible<ArenaPtr<T>> : Convertible<T> { };
+
+/**
+ * for object allocated in arena. ex. cast<ArenaPtr<T>>()
+ */
+template <typename T, typename C>
+struct Cast<ArenaPtr<T>, C> : expression::Mapper {
+    using retType = ArenaPtr<T>;
+
+    template <typename Iterator, typename Policy, typename U>
+    auto operator()(ParserState<Iterator, Policy> &state, ArenaPtr<U> &&value) const {
+        static_assert(std::is_base_of<T, U>::value || std::is_base_of<U, T>::value, "must be base type of derived type");
+        if(!C()(*value.get())) {
+            state.setResult(false);
+            return ArenaPtr<T>();
+        }
+        return ArenaPtr<T>(static_cast<T *>(value.get()));
+    }
+};
+
 template <typename Functor, typename T>
 struct JoinerBase : expression::Mapper {
     static_assert(expression::is_expr<T>::value, "must be Expression");
@@ -118,6 +160,22 @@ struct JoinerBase : expression::Mapper {
     T expr;
 
     constexpr explicit JoinerBase(T expr) : expr(expr) { }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->expr.minLength();
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->expr.maxLength();
+    }
 };
 
 
@@ -125,8 +183,8 @@ template <typename Functor, typename T>
 struct Joiner : JoinerBase<Functor, T> {
     constexpr explicit Joiner(T expr) : JoinerBase<Functor, T>(expr) { }
 
-    template <typename Iterator, typename Value>
-    auto operator()(ParserState<Iterator> &state, Value &&v) const {
+    template <typename Iterator, typename Policy, typename Value>
+    auto operator()(ParserState<Iterator, Policy> &state, Value &&v) const {
         auto r = this->expr(state);
         if(state.result()) {
             misc::unpackAndAppend<Functor>(v, std::forward<Value>(r));
@@ -144,12 +202,30 @@ struct EachJoiner : JoinerBase<Functor, T> {
 
     constexpr EachJoiner(T expr, D delim) : JoinerBase<Functor, T>(expr), delim(delim) { }
 
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.nullable() ? this->expr.firstSet() + this->delim.firstSet() : this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return Low == 0 || this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return Low == 0 ? 0 : expression::addLength(expression::mulLength(this->expr.minLength(), Low),
+                                                    expression::mulLength(this->delim.minLength(), Low - 1));
+    }
+
+    constexpr std::size_t maxLength() const {
+        return High == 0 ? 0 : expression::addLength(expression::mulLength(this->expr.maxLength(), High),
+                                                     expression::mulLength(this->delim.maxLength(), High - 1));
+    }
+
     static bool isGreaterThan(size_t index, size_t limit) {
         return index >= limit;
     }
 
-    template <typename Iterator, typename Value>
-    auto operator()(ParserState<Iterator> &state, Value &&v) const {
+    template <typename Iterator, typename Policy, typename Value>
+    auto operator()(ParserState<Iterator, Policy> &state, Value &&v) const {
         size_t index = 0;
         for(; index < High; index++) {
             // match delimiter
@@ -161,8 +237,10 @@ struct EachJoiner : JoinerBase<Functor, T> {
             }
 
             // match expression
+            expression::ArenaGuard<Policy> guard(state);
             auto r = this->expr(state);
             if(!state.result()) {
+                guard.rollbackIfFailed(state);
                 break;
             }
 
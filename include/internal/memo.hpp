@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_MEMO_HPP
+#define AQUARIUS_CXX_INTERNAL_MEMO_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace aquarius {
+
+/**
+ * packrat memoization table keyed by (rule id, 32-bit input offset).
+ * open addressing with linear probing. buckets are allocated on first insertion,
+ * so grammars without memoized rules never touch the heap.
+ */
+class MemoTable {
+public:
+    /**
+     * max input offset which can be memoized.
+     */
+    static constexpr std::size_t MAX_OFFSET = static_cast<std::uint32_t>(-1);
+
+    struct Entry {
+        std::uint64_t key;
+
+        /**
+         * cursor offset after rule application
+         */
+        std::uint32_t end;
+
+        /**
+         * longest matched failure offset after rule application
+         */
+        std::uint32_t failure;
+
+        bool success;
+    };
+
+private:
+    static constexpr std::uint64_t EMPTY_KEY = static_cast<std::uint64_t>(-1);
+
+    std::vector<Entry> buckets_;
+
+    std::size_t size_{0};
+
+    std::size_t lookupCount_{0};
+
+    std::size_t hitCount_{0};
+
+    static std::uint64_t makeKey(std::uint32_t ruleId, std::uint32_t offset) {
+        return (static_cast<std::uint64_t>(ruleId) << 32) | offset;
+    }
+
+    static std::size_t hash(std::uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return static_cast<std::size_t>(key);
+    }
+
+    Entry *probe(std::uint64_t key) {
+        const std::size_t mask = this->buckets_.size() - 1;
+        for(std::size_t index = hash(key) & mask; ; index = (index + 1) & mask) {
+            Entry &e = this->buckets_[index];
+            if(e.key == key || e.key == EMPTY_KEY) {
+                return &e;
+            }
+        }
+    }
+
+    void grow() {
+        std::vector<Entry> old;
+        old.swap(this->buckets_);
+        this->buckets_.resize(old.empty() ? 64 : old.size() * 2, Entry{EMPTY_KEY, 0, 0, false});
+        for(auto &e : old) {
+            if(e.key != EMPTY_KEY) {
+                *this->probe(e.key) = e;
+            }
+        }
+    }
+
+public:
+    /**
+     *
+     * @param ruleId
+     * @param offset
+     * @return
+     * if not found, return null
+     */
+    const Entry *find(std::uint32_t ruleId, std::uint32_t offset) {
+        this->lookupCount_++;
+        if(this->size_ == 0) {
+            return nullptr;
+        }
+        Entry *e = this->probe(makeKey(ruleId, offset));
+        if(e->key == EMPTY_KEY) {
+            return nullptr;
+        }
+        this->hitCount_++;
+        return e;
+    }
+
+    void insert(std::uint32_t ruleId, std::uint32_t offset, std::uint32_t end, std::uint32_t failure, bool success) {
+        if((this->size_ + 1) * 2 > this->buckets_.size()) {
+            this->grow();
+        }
+        Entry *e = this->probe(makeKey(ruleId, offset));
+        if(e->key == EMPTY_KEY) {
+            this->size_++;
+        }
+        *e = Entry{makeKey(ruleId, offset), end, failure, success};
+    }
+
+    void clear() {
+        this->buckets_.clear();
+        this->size_ = 0;
+        this->lookupCount_ = 0;
+        this->hitCount_ = 0;
+    }
+
+    /**
+     *
+     * @return
+     * number of memoized (rule, offset) pairs
+     */
+    std::size_t size() const {
+        return this->size_;
+    }
+
+    std::size_t capacity() const {
+        return this->buckets_.size();
+    }
+
+    std::size_t lookupCount() const {
+        return this->lookupCount_;
+    }
+
+    std::size_t hitCount() const {
+        return this->hitCount_;
+    }
+
+    double hitRate() const {
+        return this->lookupCount_ == 0 ? 0.0 :
+               static_cast<double>(this->hitCount_) / static_cast<double>(this->lookupCount_);
+    }
+};
+
+/**
+ * placeholder of MemoTable for policy without memoization (Policy::useMemo is false).
+ */
+struct NoMemoTable { };
+
+/**
+ * get unique id of rule. ids are assigned in order of first use.
+ */
+inline std::uint32_t nextRuleId() {
+    static std::atomic<std::uint32_t> count(0);
+    return count++;
+}
+
+template <typename T>
+inline std::uint32_t ruleId() {
+    static const std::uint32_t id = nextRuleId();
+    return id;
+}
+
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_MEMO_HPP
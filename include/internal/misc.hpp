@@ -17,8 +17,11 @@
 #ifndef AQUARIUS_CXX_INTERNAL_MISC_HPP
 #define AQUARIUS_CXX_INTERNAL_MISC_HPP
 
+#include <new>
 #include <type_traits>
 #include <iterator>
+#include <string>
+#include <vector>
 
 namespace aquarius {
 namespace misc {
@@ -114,6 +117,52 @@ using is_random_access_iter =
 typename std::is_same<typename std::iterator_traits<T>::iterator_category, std::random_access_iterator_tag>;
 
 
+/**
+ * check whether a iterator points to contiguous char array
+ * (char pointer, iterator of std::string or std::vector<char>).
+ */
+template <typename T>
+struct is_contiguous_char_iter : std::integral_constant<bool,
+        std::is_same<T, char *>::value || std::is_same<T, const char *>::value ||
+        std::is_same<T, std::string::iterator>::value || std::is_same<T, std::string::const_iterator>::value ||
+        std::is_same<T, std::vector<char>::iterator>::value ||
+        std::is_same<T, std::vector<char>::const_iterator>::value> { };
+
+/**
+ * get raw pointer from contiguous char iterator. iterator must be dereferenceable.
+ */
+template <typename T, enable_when<is_contiguous_char_iter<T>::value> = nullptr>
+inline const char *toPointer(T iter) {
+    return &*iter;
+}
+
+/**
+ * check whether a rule is declared with AQ_DEFINE_MEMO_RULE.
+ */
+template <typename T, typename = void>
+struct is_memo_rule : std::false_type { };
+
+template <typename T>
+struct is_memo_rule<T, std::enable_if_t<T::memoize>> : std::true_type { };
+
+/**
+ * get name of rule declared with AQ_DEFINE_RULE (or AQ_DEFINE_MEMO_RULE).
+ */
+template <typename T>
+constexpr auto ruleName(int) -> decltype(T::ruleName()) {
+    return T::ruleName();
+}
+
+template <typename T>
+constexpr const char *ruleName(long) {
+    return "(anonymous)";
+}
+
+template <typename T>
+constexpr const char *ruleName() {
+    return ruleName<T>(0);
+}
+
 template <typename T>
 inline T constexpr_error(const char *) {
     abort();
@@ -135,39 +184,137 @@ public:
 template <typename T>
 class Optional : public misc::NonCopyable<Optional<T>> {
 private:
-    T *value_;
+    /**
+     * inline storage of value. valid only if hasValue_ is true
+     */
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+
+    bool hasValue_;
 
 public:
-    Optional() : value_(nullptr) { }
+    Optional() : hasValue_(false) { }
 
-    explicit Optional(T &&t) : value_(new T) {
-        *this->value_ = std::move(t);
+    explicit Optional(T &&t) : hasValue_(false) {
+        this->emplace(std::move(t));
     }
 
-    Optional(Optional &&o) noexcept : value_(o.value_) {
-        o.value_ = nullptr;
+    /**
+     * after moved, o does not have value.
+     * @param o
+     */
+    Optional(Optional &&o) noexcept : hasValue_(false) {
+        if(o.hasValue_) {
+            this->emplace(std::move(o.get()));
+            o.reset();
+        }
     }
 
     ~Optional() {
-        delete this->value_;
+        this->reset();
     }
 
     Optional &operator=(Optional &&o) noexcept {
-        auto tmp(std::move(o));
-        this->swap(tmp);
+        if(this != &o) {
+            this->reset();
+            if(o.hasValue_) {
+                this->emplace(std::move(o.get()));
+                o.reset();
+            }
+        }
         return *this;
     }
 
+    /**
+     * construct value in place. if already has value, destroy it before construction.
+     * @param arg
+     * @return
+     */
+    template <typename ... Arg>
+    T &emplace(Arg && ...arg) {
+        this->reset();
+        new(&this->storage_) T(std::forward<Arg>(arg)...);
+        this->hasValue_ = true;
+        return this->get();
+    }
+
+    void reset() {
+        if(this->hasValue_) {
+            this->get().~T();
+            this->hasValue_ = false;
+        }
+    }
+
     void swap(Optional &o) {
-        std::swap(this->value_, o.value_);
+        Optional tmp(std::move(o));
+        o = std::move(*this);
+        *this = std::move(tmp);
     }
 
     explicit operator bool() const {
-        return this->value_ != nullptr;
+        return this->hasValue_;
     }
 
     T &get() {
-        return *this->value_;
+        return *reinterpret_cast<T *>(&this->storage_);
+    }
+
+    const T &get() const {
+        return *reinterpret_cast<const T *>(&this->storage_);
+    }
+};
+
+/**
+ * non-owning reference to contiguous characters of input.
+ * referred input must outlive this object.
+ */
+class StringView {
+private:
+    const char *data_;
+    std::size_t size_;
+
+public:
+    constexpr StringView() : data_(nullptr), size_(0) { }
+
+    constexpr StringView(const char *data, std::size_t size) : data_(data), size_(size) { }
+
+    const char *data() const {
+        return this->data_;
+    }
+
+    std::size_t size() const {
+        return this->size_;
+    }
+
+    bool empty() const {
+        return this->size_ == 0;
+    }
+
+    const char *begin() const {
+        return this->data_;
+    }
+
+    const char *end() const {
+        return this->data_ + this->size_;
+    }
+
+    char operator[](std::size_t index) const {
+        return this->data_[index];
+    }
+
+    std::string toString() const {
+        return std::string(this->data_, this->size_);
+    }
+
+    operator std::string() const {  //NOLINT
+        return this->toString();
+    }
+
+    bool operator==(const StringView &o) const {
+        return this->size_ == o.size_ && std::char_traits<char>::compare(this->data_, o.data_, this->size_) == 0;
+    }
+
+    bool operator!=(const StringView &o) const {
+        return !(*this == o);
     }
 };
 
@@ -17,13 +17,167 @@
 #ifndef AQUARIUS_CXX_INTERNAL_PARSER_HPP
 #define AQUARIUS_CXX_INTERNAL_PARSER_HPP
 
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+
 #include "misc.hpp"
 #include "expression.hpp"
 
 namespace aquarius {
 
+/**
+ * longest matched failure of parse.
+ */
+struct ParseError {
+    /**
+     * byte offset from beginning of input
+     */
+    std::size_t offset{0};
+
+    /**
+     * 1-based
+     */
+    std::size_t line{1};
+
+    /**
+     * 1-based, in bytes
+     */
+    std::size_t column{1};
+
+    /**
+     * if true, failed at end of input
+     */
+    bool reachedEnd{false};
+
+    /**
+     * bytes which can be accepted at offset
+     */
+    unicode_util::ByteMap expected;
+
+    /**
+     * byte at offset. if reachedEnd is true, 0
+     */
+    unsigned char found{0};
+
+    /**
+     *
+     * @return
+     * ex. "1:5: expected ',', ']' or '0'-'9', but found 'x'"
+     */
+    std::string message() const {
+        std::string str = std::to_string(this->line);
+        str += ':';
+        str += std::to_string(this->column);
+        str += ": ";
+
+        std::vector<std::string> ranges;
+        for(unsigned int b = 0; b < 256; b++) {
+            if(!this->expected.contains(static_cast<unsigned char>(b))) {
+                continue;
+            }
+            unsigned int stop = b;
+            for(; stop + 1 < 256 && this->expected.contains(static_cast<unsigned char>(stop + 1)); stop++);
+            if(stop == b + 1) {     // not range
+                stop = b;
+            }
+            std::string range = formatByte(b);
+            if(stop > b) {
+                range += '-';
+                range += formatByte(stop);
+            }
+            ranges.push_back(std::move(range));
+            b = stop;
+        }
+        if(!ranges.empty()) {
+            str += "expected ";
+            for(unsigned int i = 0; i < ranges.size(); i++) {
+                if(i > 0) {
+                    str += i + 1 == ranges.size() ? " or " : ", ";
+                }
+                str += ranges[i];
+            }
+            str += ", but ";
+        }
+        str += "found ";
+        str += this->reachedEnd ? "end of input" : formatByte(this->found);
+        return str;
+    }
+
+private:
+    static std::string formatByte(unsigned int b) {
+        char buf[8];
+        if(b >= 0x20 && b < 0x7F) {
+            std::snprintf(buf, sizeof(buf), "'%c'", static_cast<char>(b));
+        } else {
+            std::snprintf(buf, sizeof(buf), "\\x%02X", b);
+        }
+        return buf;
+    }
+};
+
+/**
+ * get longest matched failure from state. failure position is available only if policy tracks it
+ * (expected bytes are available only in DiagnosticPolicy).
+ * @param state
+ * @return
+ */
+template <typename RandomAccessIterator, typename Policy>
+inline ParseError createError(const ParserState<RandomAccessIterator, Policy> &state) {
+    ParseError error;
+    error.offset = static_cast<std::size_t>(std::distance(state.begin(), state.failure()));
+    for(auto iter = state.begin(); iter != state.failure(); ++iter) {
+        if(*iter == '\n') {
+            error.line++;
+            error.column = 1;
+        } else {
+            error.column++;
+        }
+    }
+    error.reachedEnd = state.failure() == state.end();
+    error.expected = state.expected();
+    error.found = error.reachedEnd ? 0 : static_cast<unsigned char>(*state.failure());
+    return error;
+}
+
+/**
+ * consumed size and longest matched failure of parse. common part of ParsedResult.
+ */
+class ParsedOffsets {
+protected:
+    std::size_t consumedSize_{0};
+
+    std::size_t failureOffset_{0};
+
+public:
+    /**
+     *
+     * @return
+     * consumed size from start position of parse. if failed, always 0
+     */
+    std::size_t consumedSize() const {
+        return this->consumedSize_;
+    }
+
+    /**
+     *
+     * @return
+     * offset of longest matched failure from beginning of input.
+     * if policy does not track failure (ex. FastPolicy), meaningless
+     */
+    std::size_t failureOffset() const {
+        return this->failureOffset_;
+    }
+
+    void setOffsets(std::size_t consumedSize, std::size_t failureOffset) {
+        this->consumedSize_ = consumedSize;
+        this->failureOffset_ = failureOffset;
+    }
+};
+
 template <typename T>
-class ParsedResult {
+class ParsedResult : public ParsedOffsets {
 private:
     Optional<T> value_;
 
@@ -31,7 +185,7 @@ public:
     ParsedResult() = default;
     explicit ParsedResult(T &&value) : value_(std::move(value)) { }
 
-    ParsedResult(ParsedResult &&r) noexcept : value_(std::move(r.value_)) { }
+    ParsedResult(ParsedResult &&r) noexcept : ParsedOffsets(r), value_(std::move(r.value_)) { }
 
     ~ParsedResult() = default;
 
@@ -43,6 +197,8 @@ public:
 
     void swap(ParsedResult<T> &r) {
         this->value_.swap(r.value_);
+        std::swap(this->consumedSize_, r.consumedSize_);
+        std::swap(this->failureOffset_, r.failureOffset_);
     }
 
     explicit operator bool() const {
@@ -60,7 +216,7 @@ public:
 };
 
 template <>
-class ParsedResult<void> {
+class ParsedResult<void> : public ParsedOffsets {
 private:
     bool success;
 
@@ -76,17 +232,181 @@ public:
     }
 };
 
-template <typename RULE>
+/**
+ * @tparam RULE
+ * @tparam Policy
+ * policy of ParserState created by parser (see policy.hpp)
+ */
+template <typename RULE, typename Policy = DefaultPolicy>
 struct Parser {
     using retType = typename expression::NonTerminal<RULE>::retType;
 
     template <typename RandomAccessIterator, typename P = retType,
             misc::enable_when<std::is_void<P>::value> = nullptr>
     ParsedResult<void> operator()(RandomAccessIterator begin, RandomAccessIterator end) const {
-        constexpr auto p = RULE::pattern();
+        auto state = createState<Policy>(begin, end);
+        return (*this)(state);
+    }
+
+    template <typename RandomAccessIterator, typename P = retType,
+            misc::enable_when<!std::is_void<P>::value> = nullptr>
+    ParsedResult<retType> operator()(RandomAccessIterator begin, RandomAccessIterator end) const {
+        auto state = createState<Policy>(begin, end);
+        return (*this)(state);
+    }
+
+    /**
+     * parse in two phase. at first, parse without error bookkeeping (FastPolicyOf<Policy>).
+     * only if failed, parse again with DiagnosticPolicyOf<Policy> and get error.
+     * if Policy uses arena, use overload which takes arena.
+     * @param begin
+     * @param end
+     * @param error
+     * if failed, set longest matched failure. otherwise, reset
+     * @return
+     * if failed, failureOffset() is same as offset of error
+     */
+    template <typename RandomAccessIterator>
+    ParsedResult<retType> operator()(RandomAccessIterator begin, RandomAccessIterator end, ParseError &error) const {
+        return this->parseTwoPhase<Policy>(begin, end, nullptr, error);
+    }
+
+    /**
+     * parse in two phase and allocate objects in arena. if failed, objects allocated by both phases are rolled back.
+     * @param begin
+     * @param end
+     * @param arena
+     * @param error
+     * if failed, set longest matched failure. otherwise, reset
+     * @return
+     */
+    template <typename RandomAccessIterator>
+    ParsedResult<retType> operator()(RandomAccessIterator begin, RandomAccessIterator end,
+                                     Arena &arena, ParseError &error) const {
+        using P = typename std::conditional<Policy::useArena, Policy, ArenaPolicy<Policy>>::type;
+        return this->parseTwoPhase<P>(begin, end, &arena, error);
+    }
+
+    /**
+     * parse and allocate objects in arena (see allocate<T>()). allocations of failed alternatives are
+     * rolled back, and remaining objects are valid until arena is cleared.
+     * @param begin
+     * @param end
+     * @param arena
+     * @return
+     */
+    template <typename RandomAccessIterator>
+    ParsedResult<retType> operator()(RandomAccessIterator begin, RandomAccessIterator end, Arena &arena) const {
+        using P = typename std::conditional<Policy::useArena, Policy, ArenaPolicy<Policy>>::type;
+        auto state = createState<P>(begin, end);
+        state.policy().setArena(arena);
+        return (*this)(state);
+    }
+
+    /**
+     * parse next record from offset. remaining input is not required to match,
+     * so back-to-back records can be walked without copying.
+     *
+     *   for(std::size_t offset = 0; offset < size;) {
+     *       auto r = parser.parseFrom(begin, end, offset);
+     *       if(!r) { break; }
+     *       offset += r.consumedSize();
+     *   }
+     * @param begin
+     * beginning of whole input
+     * @param end
+     * @param offset
+     * start offset of parse. must not be greater than input size
+     * @return
+     * failureOffset() is relative to begin (not start offset)
+     */
+    template <typename RandomAccessIterator>
+    ParsedResult<retType> parseFrom(RandomAccessIterator begin, RandomAccessIterator end, std::size_t offset) const {
+        auto state = createState<Policy>(begin, end);
+        state.cursor() = begin + offset;
+        return (*this)(state);
+    }
+
+    /**
+     * parse and require whole input to match.
+     * @param begin
+     * @param end
+     * @return
+     * if rule matches only prefix of input, failed and failureOffset() is at least end of matched prefix.
+     */
+    template <typename RandomAccessIterator>
+    ParsedResult<retType> parseAll(RandomAccessIterator begin, RandomAccessIterator end) const {
+        auto state = createState<Policy>(begin, end);
+        return this->parseAll(state);
+    }
+
+    template <typename RandomAccessIterator, typename StatePolicy>
+    ParsedResult<retType> parseAll(ParserState<RandomAccessIterator, StatePolicy> &state) const {
+        auto r = (*this)(state);
+        if(r && state.cursor() != state.end()) {
+            state.reportFailure();
+            r = ParsedResult<retType>();
+            r.setOffsets(0, std::distance(state.begin(), std::max(state.failure(), state.cursor())));
+        }
+        return r;
+    }
+
+    /**
+     * parse with user supplied state. after parsing, state can be inspected (ex. memoization table).
+     * parse starts at current cursor of state.
+     * @param state
+     * @return
+     */
+    template <typename RandomAccessIterator, typename StatePolicy>
+    ParsedResult<retType> operator()(ParserState<RandomAccessIterator, StatePolicy> &state) const {
+        const auto start = state.cursor();
+        auto r = this->apply(state);
+        r.setOffsets(r ? std::distance(start, state.cursor()) : 0,
+                     std::distance(state.begin(), std::max(state.failure(), start)));
+        return r;
+    }
+
+private:
+    template <typename P, typename RandomAccessIterator>
+    ParsedResult<retType> parseTwoPhase(RandomAccessIterator begin, RandomAccessIterator end,
+                                        Arena *arena, ParseError &error) const {
+        error = ParseError();
+        const Arena::Checkpoint checkpoint = arena != nullptr ? arena->checkpoint() : Arena::Checkpoint();
+        auto state = createState<FastPolicyOf<P>>(begin, end);
+        setArena(state.policy(), arena);
+        auto r = (*this)(state);
+        if(!r) {
+            if(arena != nullptr) {
+                arena->rollback(checkpoint);
+            }
+            auto diagnostic = createState<DiagnosticPolicyOf<P>>(begin, end);
+            setArena(diagnostic.policy(), arena);
+            (*this)(diagnostic);
+            if(arena != nullptr) {
+                arena->rollback(checkpoint);
+            }
+            error = createError(diagnostic);
+            r.setOffsets(0, error.offset);  // first phase does not track failure
+        }
+        return r;
+    }
+
+    template <typename P, misc::enable_when<P::useArena> = nullptr>
+    static void setArena(P &policy, Arena *arena) {
+        if(arena != nullptr) {
+            policy.setArena(*arena);
+        }
+    }
+
+    template <typename P, misc::enable_when<!P::useArena> = nullptr>
+    static void setArena(P &, Arena *) { }
+
+    template <typename RandomAccessIterator, typename StatePolicy, typename P = retType,
+            misc::enable_when<std::is_void<P>::value> = nullptr>
+    ParsedResult<void> apply(ParserState<RandomAccessIterator, StatePolicy> &state) const {
+        constexpr expression::NonTerminal<RULE> p;
 
         ParsedResult<void> r;
-        auto state = createState(begin, end);
         p(state);
         if(state.result()) {
             r = ParsedResult<void>(true);
@@ -94,18 +414,16 @@ struct Parser {
         return r;
     }
 
-    template <typename RandomAccessIterator, typename P = retType,
+    template <typename RandomAccessIterator, typename StatePolicy, typename P = retType,
             misc::enable_when<!std::is_void<P>::value> = nullptr>
-    ParsedResult<retType> operator()(RandomAccessIterator begin, RandomAccessIterator end) const {
-        constexpr auto p = RULE::pattern();
+    ParsedResult<retType> apply(ParserState<RandomAccessIterator, StatePolicy> &state) const {
+        constexpr expression::NonTerminal<RULE> p;
 
-        ParsedResult<retType> r;
-        auto state = createState(begin, end);
         auto v = p(state);
-        if(state.result()) {
-            r = ParsedResult<retType>(std::move(v));
+        if(!state.result()) {
+            return ParsedResult<retType>();
         }
-        return r;
+        return ParsedResult<retType>(std::move(v));
     }
 };
 
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_POLICY_HPP
+#define AQUARIUS_CXX_INTERNAL_POLICY_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "arena.hpp"
+
+namespace aquarius {
+
+/**
+ * compile-time policy of ParserState. disabled feature is removed at compile time.
+ *
+ * policy type must provide following members.
+ *
+ *   static constexpr bool trackFailure;    // if true, track longest matched failure position
+ *   static constexpr bool trackExpected;   // if true, collect expected bytes at longest matched failure
+ *   static constexpr bool hookRule;        // if true, call enterRule() and exitRule() at each rule application
+ *   static constexpr bool useArena;        // if true, provide Arena &arena() and roll back it at backtracking
+ *   static constexpr bool trackEnd;        // if true, record failure at end of input (see ParserState::reachedEnd())
+ *   static constexpr bool useMemo;         // if true, ParserState has MemoTable and memoized rule is memoized
+ *
+ *   void enterRule(std::uint32_t id, const char *name, std::size_t offset);
+ *   void exitRule(std::uint32_t id, const char *name, std::size_t offset, bool success);
+ *
+ * trackExpected costs ByteMap in each ParserState and update of it at each reported failure.
+ * trackEnd costs compare and store at each reported failure. StreamParser requires it.
+ * useMemo costs MemoTable in each ParserState (heap is allocated at first insertion only).
+ * if false, memoized rule is applied like usual rule.
+ * storage of disabled feature is not kept in ParserState.
+ */
+struct PolicyBase {
+    static constexpr bool trackFailure = true;
+    static constexpr bool trackExpected = false;
+    static constexpr bool hookRule = false;
+    static constexpr bool useArena = false;
+    static constexpr bool trackEnd = true;
+    static constexpr bool useMemo = true;
+
+    void enterRule(std::uint32_t, const char *, std::size_t) { }
+
+    void exitRule(std::uint32_t, const char *, std::size_t, bool) { }
+};
+
+/**
+ * only parse result and consumed size are available. failure position and end of input are not tracked,
+ * and sequence longer than remaining input fails without trying it.
+ * for re-parsing on failure, use DiagnosticPolicy.
+ */
+struct FastPolicy : PolicyBase {
+    static constexpr bool trackFailure = false;
+    static constexpr bool trackEnd = false;
+};
+
+/**
+ * track longest matched failure position.
+ */
+struct DefaultPolicy : PolicyBase { };
+
+/**
+ * track longest matched failure position and expected bytes at there.
+ */
+struct DiagnosticPolicy : PolicyBase {
+    static constexpr bool trackExpected = true;
+};
+
+/**
+ * same as Base, but failure and end of input are not tracked (like FastPolicy). rule hook and arena of Base are kept.
+ * @tparam Base
+ */
+template <typename Base>
+struct FastPolicyOf : Base {
+    static constexpr bool trackFailure = false;
+    static constexpr bool trackExpected = false;
+    static constexpr bool trackEnd = false;
+};
+
+/**
+ * same as Base, but failure, expected bytes and end of input are tracked (like DiagnosticPolicy).
+ * rule hook and arena of Base are kept.
+ * @tparam Base
+ */
+template <typename Base>
+struct DiagnosticPolicyOf : Base {
+    static constexpr bool trackFailure = true;
+    static constexpr bool trackExpected = true;
+    static constexpr bool trackEnd = true;
+};
+
+/**
+ * allocate objects in user supplied arena (see allocate<T>()).
+ * allocations made by failed alternative of choice (or option, repetition) are rolled back.
+ * @tparam Base
+ * policy of failure tracking and rule hook
+ */
+template <typename Base = DefaultPolicy>
+class ArenaPolicy : public Base {
+private:
+    Arena *arena_{nullptr};
+
+public:
+    static constexpr bool useArena = true;
+
+    /**
+     * must be called before parsing.
+     * @param arena
+     * must outlive parse result
+     */
+    void setArena(Arena &arena) {
+        this->arena_ = &arena;
+    }
+
+    Arena &arena() {
+        return *this->arena_;
+    }
+};
+
+/**
+ * count rule applications per rule and max nesting depth of them.
+ */
+class InstrumentedPolicy : public PolicyBase {
+public:
+    static constexpr bool hookRule = true;
+
+    struct RuleStat {
+        const char *name;
+        std::size_t success;
+        std::size_t failure;
+
+        /**
+         * total consumed size of successful applications
+         */
+        std::size_t consumed;
+    };
+
+private:
+    /**
+     * indexed by rule id
+     */
+    std::vector<RuleStat> stats_;
+
+    /**
+     * start offsets of currently applied rules
+     */
+    std::vector<std::size_t> offsets_;
+
+    std::size_t maxDepth_{0};
+
+public:
+    void enterRule(std::uint32_t id, const char *name, std::size_t offset) {
+        if(id >= this->stats_.size()) {
+            this->stats_.resize(id + 1, RuleStat{nullptr, 0, 0, 0});
+        }
+        this->stats_[id].name = name;
+        this->offsets_.push_back(offset);
+        if(this->offsets_.size() > this->maxDepth_) {
+            this->maxDepth_ = this->offsets_.size();
+        }
+    }
+
+    void exitRule(std::uint32_t id, const char *, std::size_t offset, bool success) {
+        RuleStat &stat = this->stats_[id];
+        if(success) {
+            stat.success++;
+            stat.consumed += offset - this->offsets_.back();
+        } else {
+            stat.failure++;
+        }
+        this->offsets_.pop_back();
+    }
+
+    /**
+     *
+     * @return
+     * indexed by rule id. if name is null, rule is not applied
+     */
+    const std::vector<RuleStat> &stats() const {
+        return this->stats_;
+    }
+
+    std::size_t maxDepth() const {
+        return this->maxDepth_;
+    }
+
+    void clear() {
+        this->stats_.clear();
+        this->offsets_.clear();
+        this->maxDepth_ = 0;
+    }
+};
+
+/**
+ * record recent rule events into fixed size ring buffer. never allocate while parsing.
+ * after parse failure (or slow parse), dump() it.
+ * @tparam N
+ * max number of recorded events. must be power of 2
+ * @tparam Base
+ * policy of failure tracking (ex. FastPolicy for always-on tracing)
+ */
+template <std::size_t N = 256, typename Base = DefaultPolicy>
+class TracePolicy : public Base {
+public:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "must be power of 2");
+    static_assert(!Base::hookRule, "base policy must not hook rule");
+
+    static constexpr bool hookRule = true;
+
+    enum Kind : std::uint32_t {
+        ENTER,
+        EXIT,   // success
+        FAIL,
+    };
+
+    struct Event {
+        const char *name;
+        std::uint32_t ruleId;
+        Kind kind;
+        std::size_t offset;
+    };
+
+private:
+    Event events_[N];
+
+    /**
+     * total number of recorded events
+     */
+    std::size_t count_{0};
+
+public:
+    TracePolicy() { }    //NOLINT, not zero-fill buffer
+
+    void enterRule(std::uint32_t id, const char *name, std::size_t offset) {
+        this->record(Event{name, id, ENTER, offset});
+    }
+
+    void exitRule(std::uint32_t id, const char *name, std::size_t offset, bool success) {
+        this->record(Event{name, id, success ? EXIT : FAIL, offset});
+    }
+
+    std::size_t count() const {
+        return this->count_;
+    }
+
+    /**
+     *
+     * @param index
+     * 0 is oldest event in buffer. must be less than min(count(), N)
+     * @return
+     */
+    const Event &at(std::size_t index) const {
+        return this->events_[(this->count_ > N ? this->count_ - N + index : index) & (N - 1)];
+    }
+
+    /**
+     *
+     * @return
+     * recorded events (oldest first), one event per line. ex. "enter value @12"
+     */
+    std::string dump() const {
+        static const char *const kinds[] = {"enter", "exit", "fail"};
+
+        const std::size_t size = this->count_ > N ? N : this->count_;
+        std::string str;
+        char buf[64];
+        if(this->count_ > N) {
+            std::snprintf(buf, sizeof(buf), "... %llu events are dropped\n",
+                          static_cast<unsigned long long>(this->count_ - N));
+            str += buf;
+        }
+        for(std::size_t i = 0; i < size; i++) {
+            const Event &e = this->at(i);
+            str += kinds[e.kind];
+            str += ' ';
+            str += e.name;
+            std::snprintf(buf, sizeof(buf), " @%llu\n", static_cast<unsigned long long>(e.offset));
+            str += buf;
+        }
+        return str;
+    }
+
+    void clear() {
+        this->count_ = 0;
+    }
+
+private:
+    void record(const Event &e) {
+        this->events_[this->count_ & (N - 1)] = e;
+        this->count_++;
+    }
+};
+
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_POLICY_HPP
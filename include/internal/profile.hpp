@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_PROFILE_HPP
+#define AQUARIUS_CXX_INTERNAL_PROFILE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "policy.hpp"
+
+namespace aquarius {
+
+/**
+ * read time stamp counter. if not available, use nanoseconds of steady clock instead.
+ */
+inline std::uint64_t readCycleCounter() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_ia32_rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+struct RuleProfile {
+    /**
+     * if null, rule is never applied
+     */
+    const char *name;
+
+    std::uint64_t invocations;
+    std::uint64_t success;
+    std::uint64_t failure;
+
+    /**
+     * total consumed size of successful applications
+     */
+    std::uint64_t consumed;
+
+    /**
+     * total size of input which is matched by successful nested rules, but discarded by failure
+     */
+    std::uint64_t backtracked;
+
+    /**
+     * including nested rule applications. recursive application is counted more than once
+     */
+    std::uint64_t inclusiveCycles;
+
+    /**
+     * excluding nested rule applications
+     */
+    std::uint64_t exclusiveCycles;
+
+    void merge(const RuleProfile &p) {
+        if(this->name == nullptr) {
+            this->name = p.name;
+        }
+        this->invocations += p.invocations;
+        this->success += p.success;
+        this->failure += p.failure;
+        this->consumed += p.consumed;
+        this->backtracked += p.backtracked;
+        this->inclusiveCycles += p.inclusiveCycles;
+        this->exclusiveCycles += p.exclusiveCycles;
+    }
+};
+
+/**
+ * profiling counters of rules, indexed by rule id.
+ */
+class Profile {
+private:
+    std::vector<RuleProfile> rules_;
+
+public:
+    RuleProfile &at(std::uint32_t id) {
+        if(id >= this->rules_.size()) {
+            this->rules_.resize(id + 1, RuleProfile{nullptr, 0, 0, 0, 0, 0, 0, 0});
+        }
+        return this->rules_[id];
+    }
+
+    /**
+     *
+     * @return
+     * indexed by rule id
+     */
+    const std::vector<RuleProfile> &rules() const {
+        return this->rules_;
+    }
+
+    void merge(const Profile &p) {
+        for(std::uint32_t id = 0; id < p.rules_.size(); id++) {
+            this->at(id).merge(p.rules_[id]);
+        }
+    }
+
+    void clear() {
+        this->rules_.clear();
+    }
+
+    /**
+     *
+     * @return
+     * human readable table. sorted by exclusive cycles
+     */
+    std::string toTable() const {
+        std::uint64_t total = 0;
+        for(auto &e : this->rules_) {
+            total += e.exclusiveCycles;
+        }
+
+        char buf[512];
+        std::string str;
+        std::snprintf(buf, sizeof(buf), "%-24s %12s %12s %12s %14s %14s %16s %16s %7s\n",
+                      "rule", "calls", "success", "failure", "consumed", "backtracked",
+                      "incl-cycles", "excl-cycles", "excl%");
+        str += buf;
+        for(auto *e : this->sortedRules()) {
+            std::snprintf(buf, sizeof(buf), "%-24s %12llu %12llu %12llu %14llu %14llu %16llu %16llu %6.2f%%\n",
+                          e->name, ull(e->invocations), ull(e->success), ull(e->failure),
+                          ull(e->consumed), ull(e->backtracked), ull(e->inclusiveCycles), ull(e->exclusiveCycles),
+                          total == 0 ? 0.0 : static_cast<double>(e->exclusiveCycles) * 100.0 / total);
+            str += buf;
+        }
+        return str;
+    }
+
+    /**
+     *
+     * @return
+     * tab separated values with header line. sorted by exclusive cycles
+     */
+    std::string toTSV() const {
+        char buf[512];
+        std::string str = "rule\tcalls\tsuccess\tfailure\tconsumed\tbacktracked\tinclusive_cycles\texclusive_cycles\n";
+        for(auto *e : this->sortedRules()) {
+            std::snprintf(buf, sizeof(buf), "%s\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n",
+                          e->name, ull(e->invocations), ull(e->success), ull(e->failure),
+                          ull(e->consumed), ull(e->backtracked), ull(e->inclusiveCycles), ull(e->exclusiveCycles));
+            str += buf;
+        }
+        return str;
+    }
+
+private:
+    static unsigned long long ull(std::uint64_t v) {
+        return static_cast<unsigned long long>(v);
+    }
+
+    std::vector<const RuleProfile *> sortedRules() const {
+        std::vector<const RuleProfile *> rules;
+        for(auto &e : this->rules_) {
+            if(e.name != nullptr) {
+                rules.push_back(&e);
+            }
+        }
+        std::stable_sort(rules.begin(), rules.end(), [](const RuleProfile *x, const RuleProfile *y) {
+            return x->exclusiveCycles > y->exclusiveCycles;
+        });
+        return rules;
+    }
+};
+
+/**
+ * owns per-thread profiles. profile of exited thread is merged into retired one.
+ */
+class ProfileRegistry {
+private:
+    std::mutex mutex_;
+
+    std::vector<Profile *> live_;
+
+    Profile retired_;
+
+    ProfileRegistry() = default;
+
+public:
+    static ProfileRegistry &instance() {
+        static ProfileRegistry registry;
+        return registry;
+    }
+
+    void add(Profile *p) {
+        std::lock_guard<std::mutex> guard(this->mutex_);
+        this->live_.push_back(p);
+    }
+
+    void remove(Profile *p) {
+        std::lock_guard<std::mutex> guard(this->mutex_);
+        this->retired_.merge(*p);
+        this->live_.erase(std::find(this->live_.begin(), this->live_.end(), p));
+    }
+
+    /**
+     * merge profiles of all of threads. should be called when other threads do not parse.
+     * @return
+     */
+    Profile collect() {
+        std::lock_guard<std::mutex> guard(this->mutex_);
+        Profile p;
+        p.merge(this->retired_);
+        for(auto &e : this->live_) {
+            p.merge(*e);
+        }
+        return p;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> guard(this->mutex_);
+        this->retired_.clear();
+        for(auto &e : this->live_) {
+            e->clear();
+        }
+    }
+};
+
+struct ThreadProfile {
+    Profile profile;
+
+    ThreadProfile() {
+        ProfileRegistry::instance().add(&this->profile);
+    }
+
+    ~ThreadProfile() {
+        ProfileRegistry::instance().remove(&this->profile);
+    }
+};
+
+inline Profile &threadProfile() {
+    thread_local ThreadProfile p;
+    return p.profile;
+}
+
+/**
+ * count rule applications and cycles into profile of current thread.
+ * get result by ProfileRegistry::instance().collect()
+ */
+class ProfilePolicy : public PolicyBase {
+public:
+    static constexpr bool hookRule = true;
+
+private:
+    struct Frame {
+        std::uint64_t start;
+        std::uint64_t childCycles;
+        std::size_t offset;
+
+        /**
+         * end offset of successful nested rules
+         */
+        std::size_t reached;
+    };
+
+    Profile *profile_;
+
+    std::vector<Frame> frames_;
+
+public:
+    ProfilePolicy() : profile_(&threadProfile()), frames_() { }
+
+    void enterRule(std::uint32_t id, const char *name, std::size_t offset) {
+        RuleProfile &p = this->profile_->at(id);
+        p.name = name;
+        p.invocations++;
+        this->frames_.push_back(Frame{0, 0, offset, offset});
+        this->frames_.back().start = readCycleCounter();
+    }
+
+    void exitRule(std::uint32_t id, const char *, std::size_t offset, bool success) {
+        const std::uint64_t cycles = readCycleCounter() - this->frames_.back().start;
+        const Frame frame = this->frames_.back();
+        this->frames_.pop_back();
+
+        RuleProfile &p = this->profile_->at(id);
+        p.inclusiveCycles += cycles;
+        p.exclusiveCycles += cycles - frame.childCycles;
+        if(success) {
+            p.success++;
+            p.consumed += offset - frame.offset;
+        } else {
+            p.failure++;
+            p.backtracked += frame.reached - frame.offset;
+        }
+
+        if(!this->frames_.empty()) {
+            Frame &parent = this->frames_.back();
+            parent.childCycles += cycles;
+            if(success && offset > parent.reached) {
+                parent.reached = offset;
+            }
+        }
+    }
+
+    /**
+     * profile of current thread
+     */
+    const Profile &profile() const {
+        return *this->profile_;
+    }
+};
+
+/**
+ * calling context tree of rules. each node is distinct stack of rules, and has sampled weight.
+ */
+class CallTree {
+public:
+    static constexpr std::uint32_t ROOT = 0;
+
+    struct Node {
+        const char *name;
+        std::uint32_t ruleId;
+        std::uint32_t parent;
+        std::uint32_t firstChild;
+        std::uint32_t nextSibling;
+        std::uint64_t weight;
+    };
+
+private:
+    /**
+     * nodes_[0] is root (not a rule). child index 0 indicates no node
+     */
+    std::vector<Node> nodes_;
+
+public:
+    CallTree() : nodes_{Node{"(root)", 0, ROOT, ROOT, ROOT, 0}} { }
+
+    /**
+     * get child node. if not found, create it
+     * @param parent
+     * @param ruleId
+     * @param name
+     * @return
+     */
+    std::uint32_t child(std::uint32_t parent, std::uint32_t ruleId, const char *name) {
+        std::uint32_t index = this->nodes_[parent].firstChild;
+        for(; index != ROOT; index = this->nodes_[index].nextSibling) {
+            if(this->nodes_[index].ruleId == ruleId) {
+                return index;
+            }
+        }
+        index = static_cast<std::uint32_t>(this->nodes_.size());
+        this->nodes_.push_back(Node{name, ruleId, parent, ROOT, this->nodes_[parent].firstChild, 0});
+        this->nodes_[parent].firstChild = index;
+        return index;
+    }
+
+    void addWeight(std::uint32_t node, std::uint64_t weight) {
+        this->nodes_[node].weight += weight;
+    }
+
+    const std::vector<Node> &nodes() const {
+        return this->nodes_;
+    }
+
+    void merge(const CallTree &tree) {
+        this->mergeFrom(tree, ROOT, ROOT);
+    }
+
+    void clear() {
+        this->nodes_.resize(1);
+        this->nodes_[ROOT] = Node{"(root)", 0, ROOT, ROOT, ROOT, 0};
+    }
+
+    /**
+     *
+     * @return
+     * collapsed stack format (one line per stack, "rule1;rule2;rule3 weight"), which is accepted by
+     * flamegraph tools (ex. flamegraph.pl, speedscope, inferno)
+     */
+    std::string toCollapsed() const {
+        std::string str;
+        std::vector<const char *> names;
+        for(std::uint32_t i = 0; i < this->nodes_.size(); i++) {
+            const Node &node = this->nodes_[i];
+            if(node.weight == 0) {
+                continue;
+            }
+            names.clear();
+            for(std::uint32_t index = i; ; index = this->nodes_[index].parent) {
+                names.push_back(this->nodes_[index].name);
+                if(index == ROOT) {
+                    break;
+                }
+            }
+            if(names.size() > 1) {
+                names.pop_back();   // not print root
+            }
+            for(auto iter = names.rbegin(); iter != names.rend(); ++iter) {
+                if(iter != names.rbegin()) {
+                    str += ';';
+                }
+                str += *iter;
+            }
+            str += ' ';
+            str += std::to_string(node.weight);
+            str += '\n';
+        }
+        return str;
+    }
+
+private:
+    void mergeFrom(const CallTree &tree, std::uint32_t src, std::uint32_t dest) {
+        this->nodes_[dest].weight += tree.nodes_[src].weight;
+        for(std::uint32_t index = tree.nodes_[src].firstChild; index != ROOT; index = tree.nodes_[index].nextSibling) {
+            auto &node = tree.nodes_[index];
+            this->mergeFrom(tree, index, this->child(dest, node.ruleId, node.name));
+        }
+    }
+};
+
+/**
+ * maintain shadow stack of applied rules, and sample it at every N-th rule event (enter or exit).
+ * each sample is weighted by cycles elapsed since previous sample,
+ * so total weight of stack approximates time spent in it (excluding nested rules).
+ */
+class SamplingPolicy : public PolicyBase {
+public:
+    static constexpr bool hookRule = true;
+
+private:
+    CallTree tree_;
+
+    /**
+     * shadow stack. node of CallTree
+     */
+    std::vector<std::uint32_t> stack_;
+
+    std::uint32_t period_;
+
+    std::uint32_t countdown_;
+
+    std::uint64_t last_;
+
+public:
+    SamplingPolicy() : tree_(), stack_{CallTree::ROOT}, period_(1), countdown_(1), last_(readCycleCounter()) { }
+
+    /**
+     * @param period
+     * sample at every period-th rule event. if 0, treat as 1
+     */
+    void setPeriod(std::uint32_t period) {
+        this->period_ = period == 0 ? 1 : period;
+        this->countdown_ = this->period_;
+    }
+
+    void enterRule(std::uint32_t id, const char *name, std::size_t) {
+        this->step();
+        this->stack_.push_back(this->tree_.child(this->stack_.back(), id, name));
+    }
+
+    void exitRule(std::uint32_t, const char *, std::size_t, bool) {
+        this->step();
+        this->stack_.pop_back();
+    }
+
+    /**
+     *
+     * @return
+     * names of currently applied rules (outermost first)
+     */
+    std::vector<const char *> stack() const {
+        std::vector<const char *> names;
+        for(unsigned int i = 1; i < this->stack_.size(); i++) {
+            names.push_back(this->tree_.nodes()[this->stack_[i]].name);
+        }
+        return names;
+    }
+
+    const CallTree &callTree() const {
+        return this->tree_;
+    }
+
+private:
+    void step() {
+        if(--this->countdown_ == 0) {
+            this->countdown_ = this->period_;
+            const std::uint64_t now = readCycleCounter();
+            this->tree_.addWeight(this->stack_.back(), now - this->last_);
+            this->last_ = now;
+        }
+    }
+};
+
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_PROFILE_HPP
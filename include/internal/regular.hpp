@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_REGULAR_HPP
+#define AQUARIUS_CXX_INTERNAL_REGULAR_HPP
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "expression.hpp"
+
+namespace aquarius {
+namespace expression {
+namespace regular {
+
+/**
+ * max number of positions (consuming bytes) in single automaton
+ */
+constexpr unsigned int MAX_POSITION = 31;
+
+/**
+ * max number of byte classes in single automaton
+ */
+constexpr unsigned int MAX_CLASS = 32;
+
+/**
+ * id of start state. position p is state p + 2 (0 indicates no transition)
+ */
+constexpr unsigned int START = 1;
+
+constexpr unsigned int STATE_SIZE = MAX_POSITION + 2;
+
+// entry of transition table
+
+constexpr unsigned int NEXT_MASK = 0x3F;
+
+/**
+ * some alternative (or repetition) fails before transition. its failure is reported at current position
+ */
+constexpr unsigned int EVENT = 0x40;
+
+/**
+ * if no transition, expression matches at current position
+ */
+constexpr unsigned int ACCEPT = 0x80;
+
+/**
+ * upper 8 bits of entry. if remaining input is shorter than it, some failed string literal reports short input
+ */
+constexpr unsigned int SHORT_SHIFT = 8;
+
+constexpr unsigned int SHORT_MASK = 0xFF;
+
+/**
+ * ordered set of positions
+ */
+struct PositionList {
+    unsigned char items[MAX_POSITION];
+    unsigned int size;
+
+    constexpr PositionList() : items{}, size(0) { }
+
+    constexpr void add(unsigned int position) {
+        for(unsigned int i = 0; i < this->size; i++) {
+            if(this->items[i] == position) {
+                return;
+            }
+        }
+        this->items[this->size++] = static_cast<unsigned char>(position);
+    }
+
+    constexpr void addAll(const PositionList &list) {
+        for(unsigned int i = 0; i < list.size; i++) {
+            this->add(list.items[i]);
+        }
+    }
+};
+
+/**
+ * compiled sub expression
+ */
+struct Fragment {
+    /**
+     * positions which may match first byte. ordered by PEG evaluation order
+     */
+    PositionList first;
+
+    /**
+     * positions which may match last byte
+     */
+    PositionList last;
+
+    bool nullable;
+};
+
+/**
+ * build position automaton (Glushkov automaton) of expression.
+ * positions which may follow each position are ordered by PEG evaluation order.
+ */
+struct Builder {
+    unicode_util::ByteMap sets[MAX_POSITION];
+
+    /**
+     * if position is head of string literal, size of it. otherwise, 0
+     */
+    unsigned char literals[MAX_POSITION];
+
+    /**
+     * last entry is for start state
+     */
+    PositionList follows[MAX_POSITION + 1];
+
+    bool accepts[MAX_POSITION + 1];
+
+    unsigned int size;
+
+    /**
+     * if false, expression is not supported (too large or not equivalent to PEG)
+     */
+    bool valid;
+
+    constexpr Builder() : sets{}, literals{}, follows{}, accepts{}, size(0), valid(true) { }
+
+    constexpr Fragment empty() const {
+        return Fragment{PositionList(), PositionList(), true};
+    }
+
+    constexpr Fragment leaf(unicode_util::ByteMap set, std::size_t literal = 0) {
+        Fragment fragment{PositionList(), PositionList(), false};
+        if(this->size == MAX_POSITION || literal > SHORT_MASK) {
+            this->valid = false;
+            return fragment;
+        }
+        this->sets[this->size] = set;
+        this->literals[this->size] = static_cast<unsigned char>(literal);
+        fragment.first.add(this->size);
+        fragment.last.add(this->size);
+        this->size++;
+        return fragment;
+    }
+
+    constexpr Fragment sequence(const Fragment &left, const Fragment &right) {
+        Fragment fragment{left.first, right.last, left.nullable && right.nullable};
+        for(unsigned int i = 0; i < left.last.size; i++) {
+            this->follows[left.last.items[i]].addAll(right.first);
+        }
+        if(left.nullable) {
+            fragment.first.addAll(right.first);
+        }
+        if(right.nullable) {
+            fragment.last.addAll(left.last);
+        }
+        return fragment;
+    }
+
+    /**
+     * ordered choice. if left is nullable, right is never tried in PEG, so not supported
+     */
+    constexpr Fragment choice(const Fragment &left, const Fragment &right) {
+        if(left.nullable) {
+            this->valid = false;
+        }
+        Fragment fragment = left;
+        fragment.first.addAll(right.first);
+        fragment.last.addAll(right.last);
+        fragment.nullable = right.nullable;
+        return fragment;
+    }
+
+    constexpr Fragment option(const Fragment &fragment) const {
+        return Fragment{fragment.first, fragment.last, true};
+    }
+
+    /**
+     * repetition of non-nullable expression (nullable one never stops in PEG)
+     */
+    constexpr Fragment repeat(const Fragment &fragment, bool nullable) {
+        if(fragment.nullable) {
+            this->valid = false;
+        }
+        for(unsigned int i = 0; i < fragment.last.size; i++) {
+            this->follows[fragment.last.items[i]].addAll(fragment.first);
+        }
+        return Fragment{fragment.first, fragment.last, nullable};
+    }
+
+    constexpr void finish(const Fragment &fragment) {
+        this->follows[MAX_POSITION] = fragment.first;
+        this->accepts[MAX_POSITION] = fragment.nullable;
+        for(unsigned int i = 0; i < fragment.last.size; i++) {
+            this->accepts[fragment.last.items[i]] = true;
+        }
+
+        // if following positions are overlapped, automaton is not deterministic
+        for(auto &follow : this->follows) {
+            for(unsigned int i = 0; i < follow.size; i++) {
+                for(unsigned int j = i + 1; j < follow.size; j++) {
+                    if(!this->sets[follow.items[i]].isDisjoint(this->sets[follow.items[j]])) {
+                        this->valid = false;
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**
+ * table driven deterministic automaton.
+ */
+struct Automaton {
+    unsigned char classes[256];
+
+    /**
+     * indexed by state and class
+     */
+    std::uint16_t table[STATE_SIZE][MAX_CLASS];
+
+    /**
+     * entry for end of input. indexed by state
+     */
+    std::uint16_t ends[STATE_SIZE];
+
+    bool valid;
+
+    constexpr explicit Automaton(const Builder &builder) :
+            classes{}, table{}, ends{}, valid(builder.valid) {
+        if(!this->valid) {
+            return;
+        }
+
+        // bytes which belong to same positions are same class
+        std::uint32_t signatures[MAX_CLASS] = {};
+        unsigned int classSize = 0;
+        for(unsigned int b = 0; b < 256; b++) {
+            std::uint32_t signature = 0;
+            for(unsigned int p = 0; p < builder.size; p++) {
+                if(builder.sets[p].contains(static_cast<unsigned char>(b))) {
+                    signature |= static_cast<std::uint32_t>(1) << p;
+                }
+            }
+            unsigned int c = 0;
+            for(; c < classSize && signatures[c] != signature; c++);
+            if(c == classSize) {
+                if(classSize == MAX_CLASS) {
+                    this->valid = false;
+                    return;
+                }
+                signatures[classSize++] = signature;
+            }
+            this->classes[b] = static_cast<unsigned char>(c);
+        }
+
+        for(unsigned int s = 0; s <= builder.size; s++) {
+            const unsigned int state = s == builder.size ? START : s + 2;
+            const unsigned int index = s == builder.size ? MAX_POSITION : s;
+            const PositionList &follow = builder.follows[index];
+            const unsigned int last = builder.accepts[index] ? ACCEPT : 0;
+            unsigned int literal = 0;
+            for(unsigned int i = 0; i < follow.size; i++) {
+                literal = literal < builder.literals[follow.items[i]] ? builder.literals[follow.items[i]] : literal;
+            }
+            for(unsigned int c = 0; c < classSize; c++) {
+                unsigned int entry = last | (follow.size > 0 ? EVENT : 0) | (literal << SHORT_SHIFT);
+                unsigned int skipped = 0;
+                for(unsigned int i = 0; i < follow.size; i++) {
+                    const unsigned int p = follow.items[i];
+                    if((signatures[c] >> p) & 1u) {
+                        entry = (i > 0 ? EVENT : 0) | (skipped << SHORT_SHIFT) | (p + 2);
+                        break;
+                    }
+                    skipped = skipped < builder.literals[p] ? builder.literals[p] : skipped;
+                }
+                this->table[state][c] = static_cast<std::uint16_t>(entry);
+            }
+            this->ends[state] = static_cast<std::uint16_t>(last | (follow.size > 0 ? EVENT : 0));
+        }
+    }
+};
+
+/**
+ * if true, T can be compiled into automaton. predicate and value expression are not supported
+ */
+template <typename T>
+struct is_regular : std::false_type { };
+
+template <>
+struct is_regular<Empty> : std::true_type { };
+
+template <>
+struct is_regular<Any> : std::true_type { };
+
+template <>
+struct is_regular<Char> : std::true_type { };
+
+template <>
+struct is_regular<CharClass> : std::true_type { };
+
+template <>
+struct is_regular<StringLiteral> : std::true_type { };
+
+template <std::size_t N>
+struct is_regular<CharString<N>> : std::true_type { };
+
+template <typename T, size_t Low, size_t High>
+struct is_regular<RepeatVoid<T, Empty, Low, High>> :
+        std::integral_constant<bool, is_regular<T>::value && Low <= 1 && High == static_cast<size_t>(-1)> { };
+
+template <typename T, size_t N>
+struct is_regular<RepeatFixed<T, N>> : is_regular<T> { };
+
+template <typename T>
+struct is_regular<OptionVoid<T>> : is_regular<T> { };
+
+template <typename T>
+struct is_regular<RestoreOnFailure<T>> : is_regular<T> { };
+
+template <typename ... T>
+struct is_regular<Sequence<T ...>> : std::integral_constant<bool, misc::allOf({is_regular<T>::value...})> { };
+
+template <typename ... T>
+struct is_regular<Choice<T ...>> : std::integral_constant<bool, misc::allOf({is_regular<T>::value...})> { };
+
+template <typename P, typename S, typename C>
+struct is_regular<FactoredChoice<P, S, C>> :
+        std::integral_constant<bool, is_regular<P>::value && is_regular<S>::value && is_regular<C>::value> { };
+
+// build automaton. compile(builder, expr) appends positions of expr
+
+constexpr Fragment compile(Builder &builder, const Empty &) {
+    return builder.empty();
+}
+
+constexpr Fragment compile(Builder &builder, const Any &expr) {
+    return builder.leaf(expr.firstSet());
+}
+
+constexpr Fragment compile(Builder &builder, const Char &expr) {
+    return builder.leaf(expr.firstSet());
+}
+
+constexpr Fragment compile(Builder &builder, const CharClass &expr) {
+    return builder.leaf(expr.firstSet());
+}
+
+constexpr Fragment compileString(Builder &builder, const char *text, std::size_t size, std::size_t literal) {
+    Fragment fragment = builder.empty();
+    for(std::size_t i = 0; i < size; i++) {
+        auto f = builder.leaf(unicode_util::ByteMap() + static_cast<unsigned char>(text[i]), i == 0 ? literal : 0);
+        fragment = builder.sequence(fragment, f);
+    }
+    return fragment;
+}
+
+/**
+ * string literal reports short input at head, so remember its size
+ */
+constexpr Fragment compile(Builder &builder, const StringLiteral &expr) {
+    return compileString(builder, expr.text, expr.size, expr.size);
+}
+
+template <std::size_t N>
+constexpr Fragment compile(Builder &builder, const CharString<N> &expr) {
+    return compileString(builder, expr.text, N, 0);
+}
+
+template <typename T, size_t Low, size_t High>
+constexpr Fragment compile(Builder &builder, const RepeatVoid<T, Empty, Low, High> &expr) {
+    return builder.repeat(compile(builder, expr.expr), Low == 0);
+}
+
+template <typename T, size_t N>
+constexpr Fragment compile(Builder &builder, const RepeatFixed<T, N> &expr) {
+    Fragment fragment = builder.empty();
+    for(size_t i = 0; i < N; i++) {
+        fragment = builder.sequence(fragment, compile(builder, expr.expr));
+    }
+    return fragment;
+}
+
+template <typename T>
+constexpr Fragment compile(Builder &builder, const OptionVoid<T> &expr) {
+    return builder.option(compile(builder, expr.expr));
+}
+
+template <typename T>
+constexpr Fragment compile(Builder &builder, const RestoreOnFailure<T> &expr) {
+    return compile(builder, expr.expr);
+}
+
+template <typename ... T, std::size_t ... I>
+constexpr Fragment compileSequence(Builder &builder, const std::tuple<T ...> &exprs, std::index_sequence<I ...>) {
+    Fragment fragment = builder.empty();
+    using expander = int[];
+    (void) expander{0, (fragment = builder.sequence(fragment, compile(builder, std::get<I>(exprs))), 0)...};
+    return fragment;
+}
+
+template <typename ... T>
+constexpr Fragment compile(Builder &builder, const Sequence<T ...> &expr) {
+    return compileSequence(builder, expr.exprs, std::index_sequence_for<T ...>());
+}
+
+template <typename ... T, std::size_t ... I>
+constexpr Fragment compileChoice(Builder &builder, const std::tuple<T ...> &exprs, std::index_sequence<I ...>) {
+    Fragment fragment = compile(builder, std::get<0>(exprs));
+    using expander = int[];
+    (void) expander{0, (fragment = builder.choice(fragment, compile(builder, std::get<I + 1>(exprs))), 0)...};
+    return fragment;
+}
+
+template <typename ... T>
+constexpr Fragment compile(Builder &builder, const Choice<T ...> &expr) {
+    return compileChoice(builder, expr.exprs, std::make_index_sequence<sizeof...(T) - 1>());
+}
+
+template <typename P, typename S, typename C>
+constexpr Fragment compile(Builder &builder, const FactoredChoice<P, S, C> &expr) {
+    if(expr.shared) {
+        auto prefix = compile(builder, expr.prefix);
+        return builder.sequence(prefix, compile(builder, expr.suffix));
+    }
+    return compile(builder, expr.choice);
+}
+
+template <typename T>
+constexpr Automaton build(const T &expr) {
+    Builder builder;
+    builder.finish(compile(builder, expr));
+    return Automaton(builder);
+}
+
+} // namespace regular
+
+/**
+ * void expression which consists of characters, strings, repetitions, options and choices (regular language).
+ * matched by deterministic automaton in single loop, if it is equivalent to PEG (next byte always determines
+ * which alternative is selected).
+ * if matching needs backtracking (or expected bytes are tracked), original expression is used instead,
+ * so result and failure position are always same as original one.
+ * cost per byte is constant regardless of which alternative is selected, so faster than original expression
+ * if input is unpredictable. for long run of single character class, original one (block skip) is faster.
+ * @tparam T
+ */
+template <typename T>
+struct Regular : ExprBase<void> {
+    T expr;
+
+    regular::Automaton automaton;
+
+    constexpr explicit Regular(T expr) : expr(expr), automaton(regular::build(expr)) { }
+
+    template <typename Iterator, typename Policy>
+    void operator()(ParserState<Iterator, Policy> &state) const {
+        applyMatch(*this, state);
+    }
+
+    template <typename Iterator, typename Policy>
+    MatchResult<Iterator> match(Iterator cursor, ParserState<Iterator, Policy> &state) const {
+        if(Policy::trackExpected || !this->automaton.valid) {
+            return this->expr.match(cursor, state);
+        }
+
+        const Iterator end = state.end();
+        Iterator pos = cursor;
+        Iterator failure = cursor;
+        bool failed = false;
+        unsigned int current = regular::START;
+        unsigned int entry;
+        for(;; ++pos) {
+            if(pos == end) {
+                entry = this->automaton.ends[current];
+                failed = failed || (entry & regular::EVENT);
+                failure = (entry & regular::EVENT) ? pos : failure;
+                break;
+            }
+            entry = this->automaton.table[current][this->automaton.classes[static_cast<unsigned char>(*pos)]];
+            failed = failed || (entry & regular::EVENT);
+            failure = (entry & regular::EVENT) ? pos : failure;
+            const unsigned int next = entry & regular::NEXT_MASK;
+            if(entry < regular::ACCEPT && next != 0) {  // common case
+                current = next;
+                continue;
+            }
+            if(static_cast<std::size_t>(end - pos) < ((entry >> regular::SHORT_SHIFT) & regular::SHORT_MASK)) {
+                return this->expr.match(cursor, state);  // string literal reports short input
+            }
+            if(next == 0) {
+                break;
+            }
+            current = next;
+        }
+
+        // no transition
+        const bool accept = (entry & regular::ACCEPT) != 0;
+        if(!accept && current != regular::START) {
+            return this->expr.match(cursor, state);  // need backtracking
+        }
+        if(failed) {
+            state.reportFailureAt(failure);
+        }
+        return {accept ? pos : cursor, accept};
+    }
+
+    constexpr unicode_util::ByteMap firstSet() const {
+        return this->expr.firstSet();
+    }
+
+    constexpr bool nullable() const {
+        return this->expr.nullable();
+    }
+
+    constexpr std::size_t minLength() const {
+        return this->expr.minLength();
+    }
+
+    constexpr std::size_t maxLength() const {
+        return this->expr.maxLength();
+    }
+};
+
+struct RegularHolder {
+    constexpr RegularHolder() {}    //NOLINT
+
+    template <typename T>
+    constexpr Regular<T> operator[](T expr) const {
+        static_assert(regular::is_regular<T>::value, "must be regular expression");
+        return Regular<T>(expr);
+    }
+};
+
+} // namespace expression
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_REGULAR_HPP
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_SIMD_HPP
+#define AQUARIUS_CXX_INTERNAL_SIMD_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AQUARIUS_X86_DISPATCH
+#endif
+
+#if defined(__AVX2__) || defined(AQUARIUS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+
+/**
+ * byte-block helpers for contiguous input.
+ * implementation is selected at compile time (AVX2 > SSE2 > SWAR > scalar),
+ * or at startup on x86-64 (see spanClass).
+ */
+namespace aquarius {
+namespace simd {
+
+inline unsigned int countTrailingZero(std::uint32_t v) {
+    return static_cast<unsigned int>(__builtin_ctz(v));
+}
+
+inline unsigned int countTrailingZero(std::uint64_t v) {
+    return static_cast<unsigned int>(__builtin_ctzll(v));
+}
+
+inline std::uint64_t load64(const char *ptr) {
+    std::uint64_t v;
+    std::memcpy(&v, ptr, sizeof(v));
+    return v;
+}
+
+/**
+ * compare two byte sequences.
+ * @param a
+ * @param b
+ * @param size
+ * @return
+ * index of first mismatched byte. if all bytes are matched, return size
+ */
+inline std::size_t mismatch(const char *a, const char *b, std::size_t size) {
+    std::size_t index = 0;
+
+#if defined(__AVX2__)
+    for(; index + 32 <= size; index += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + index));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + index));
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+        if(mask != 0xFFFFFFFFu) {
+            return index + countTrailingZero(~mask);
+        }
+    }
+#endif
+
+#if defined(__SSE2__)
+    for(; index + 16 <= size; index += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + index));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + index));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+        if(mask != 0xFFFFu) {
+            return index + countTrailingZero(~mask);
+        }
+    }
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for(; index + 8 <= size; index += 8) {
+        std::uint64_t diff = load64(a + index) ^ load64(b + index);
+        if(diff != 0) {
+            return index + countTrailingZero(diff) / 8;
+        }
+    }
+#endif
+
+    for(; index < size; index++) {
+        if(a[index] != b[index]) {
+            break;
+        }
+    }
+    return index;
+}
+
+/**
+ * nibble lookup table of ascii character class.
+ * byte b is contained in class if (low[b & 0xF] & high[b >> 4]) != 0
+ */
+struct ClassTable {
+    std::uint64_t map[2];
+    unsigned char low[16];
+    unsigned char high[16];
+
+    constexpr ClassTable(std::uint64_t lower, std::uint64_t upper) : map{lower, upper}, low{}, high{} {
+        for(unsigned int i = 0; i < 128; i++) {
+            if(this->map[i / 64] & (static_cast<std::uint64_t>(1) << (i % 64))) {
+                this->low[i & 0xF] |= static_cast<unsigned char>(1u << (i >> 4));
+            }
+        }
+        for(unsigned int i = 0; i < 8; i++) {
+            this->high[i] = static_cast<unsigned char>(1u << i);
+        }
+    }
+
+    bool contains(char ch) const {
+        auto b = static_cast<unsigned char>(ch);
+        return b < 128 && (this->map[b / 64] & (static_cast<std::uint64_t>(1) << (b % 64)));
+    }
+};
+
+inline std::size_t spanClassScalar(const char *ptr, std::size_t size, const ClassTable &table) {
+    std::size_t index = 0;
+    for(; index < size && table.contains(ptr[index]); index++);
+    return index;
+}
+
+#ifdef AQUARIUS_X86_DISPATCH
+
+__attribute__((target("ssse3")))
+inline std::size_t spanClassSSSE3(const char *ptr, std::size_t size, const ClassTable &table) {
+    const __m128i lowTable = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.low));
+    const __m128i highTable = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.high));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
+
+    std::size_t index = 0;
+    for(; index + 16 <= size; index += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + index));
+        __m128i lo = _mm_shuffle_epi8(lowTable, _mm_and_si128(v, nibble));
+        __m128i hi = _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)));
+        if(mask != 0) {
+            return index + countTrailingZero(mask);
+        }
+    }
+    return index + spanClassScalar(ptr + index, size - index, table);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t spanClassAVX2(const char *ptr, std::size_t size, const ClassTable &table) {
+    const __m256i lowTable = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.low)));
+    const __m256i highTable = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.high)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    std::size_t index = 0;
+    for(; index + 32 <= size; index += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + index));
+        __m256i lo = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(v, nibble));
+        __m256i hi = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        auto mask = static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero)));
+        if(mask != 0) {
+            return index + countTrailingZero(mask);
+        }
+    }
+    return index + spanClassSSSE3(ptr + index, size - index, table);
+}
+
+enum class SimdLevel : unsigned char {
+    SCALAR,
+    SSSE3,
+    AVX2,
+};
+
+inline SimdLevel detectSimdLevel() {
+    static const SimdLevel level =
+            __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 :
+            __builtin_cpu_supports("ssse3") ? SimdLevel::SSSE3 : SimdLevel::SCALAR;
+    return level;
+}
+
+#endif
+
+/**
+ * get length of longest prefix which consists of characters in class.
+ * @param ptr
+ * @param size
+ * @param table
+ * @return
+ */
+inline std::size_t spanClass(const char *ptr, std::size_t size, const ClassTable &table) {
+#ifdef AQUARIUS_X86_DISPATCH
+    if(size >= 16) {
+        switch(detectSimdLevel()) {
+        case SimdLevel::AVX2:
+            return spanClassAVX2(ptr, size, table);
+        case SimdLevel::SSSE3:
+            return spanClassSSSE3(ptr, size, table);
+        default:
+            break;
+        }
+    }
+#endif
+    return spanClassScalar(ptr, size, table);
+}
+
+/**
+ * up to 4 bytes to be searched by findByte. unused slots are filled with first byte,
+ * so all of slots can be compared without branch.
+ */
+struct ByteSet {
+    unsigned char bytes[4];
+    unsigned int size;
+
+    constexpr ByteSet(const char *text, unsigned int size) : bytes{}, size(size) {
+        for(unsigned int i = 0; i < 4; i++) {
+            this->bytes[i] = static_cast<unsigned char>(text[i < size ? i : 0]);
+        }
+    }
+
+    constexpr bool contains(char ch) const {
+        auto b = static_cast<unsigned char>(ch);
+        return b == this->bytes[0] || b == this->bytes[1] || b == this->bytes[2] || b == this->bytes[3];
+    }
+};
+
+inline std::size_t findByteScalar(const char *ptr, std::size_t size, const ByteSet &set) {
+    std::size_t index = 0;
+    for(; index < size && !set.contains(ptr[index]); index++);
+    return index;
+}
+
+/**
+ * non-zero bytes of return value indicate zero bytes of v (only lowest one is exact)
+ */
+inline std::uint64_t zeroByteMask(std::uint64_t v) {
+    return (v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL;
+}
+
+inline std::size_t findByteBlock(const char *ptr, std::size_t size, const ByteSet &set) {
+    std::size_t index = 0;
+
+#if defined(__SSE2__)
+    const __m128i b0 = _mm_set1_epi8(static_cast<char>(set.bytes[0]));
+    const __m128i b1 = _mm_set1_epi8(static_cast<char>(set.bytes[1]));
+    const __m128i b2 = _mm_set1_epi8(static_cast<char>(set.bytes[2]));
+    const __m128i b3 = _mm_set1_epi8(static_cast<char>(set.bytes[3]));
+    for(; index + 16 <= size; index += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + index));
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, b0), _mm_cmpeq_epi8(v, b1)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, b2), _mm_cmpeq_epi8(v, b3)));
+        auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(eq));
+        if(mask != 0) {
+            return index + countTrailingZero(mask);
+        }
+    }
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const std::uint64_t b0 = 0x0101010101010101ULL * set.bytes[0];
+    const std::uint64_t b1 = 0x0101010101010101ULL * set.bytes[1];
+    const std::uint64_t b2 = 0x0101010101010101ULL * set.bytes[2];
+    const std::uint64_t b3 = 0x0101010101010101ULL * set.bytes[3];
+    for(; index + 8 <= size; index += 8) {
+        std::uint64_t v = load64(ptr + index);
+        std::uint64_t mask = zeroByteMask(v ^ b0) | zeroByteMask(v ^ b1) |
+                             zeroByteMask(v ^ b2) | zeroByteMask(v ^ b3);
+        if(mask != 0) {
+            return index + countTrailingZero(mask) / 8;
+        }
+    }
+#endif
+
+    return index + findByteScalar(ptr + index, size - index, set);
+}
+
+#ifdef AQUARIUS_X86_DISPATCH
+
+__attribute__((target("avx2")))
+inline std::size_t findByteAVX2(const char *ptr, std::size_t size, const ByteSet &set) {
+    const __m256i b0 = _mm256_set1_epi8(static_cast<char>(set.bytes[0]));
+    const __m256i b1 = _mm256_set1_epi8(static_cast<char>(set.bytes[1]));
+    const __m256i b2 = _mm256_set1_epi8(static_cast<char>(set.bytes[2]));
+    const __m256i b3 = _mm256_set1_epi8(static_cast<char>(set.bytes[3]));
+
+    std::size_t index = 0;
+    for(; index + 32 <= size; index += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + index));
+        __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, b0), _mm256_cmpeq_epi8(v, b1)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, b2), _mm256_cmpeq_epi8(v, b3)));
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(eq));
+        if(mask != 0) {
+            return index + countTrailingZero(mask);
+        }
+    }
+    return index + findByteBlock(ptr + index, size - index, set);
+}
+
+#endif
+
+/**
+ * get index of first byte in set.
+ * @param ptr
+ * @param size
+ * @param set
+ * @return
+ * if not found, return size
+ */
+inline std::size_t findByte(const char *ptr, std::size_t size, const ByteSet &set) {
+    if(set.size == 1) {
+        const void *found = std::memchr(ptr, set.bytes[0], size);
+        return found == nullptr ? size : static_cast<std::size_t>(static_cast<const char *>(found) - ptr);
+    }
+#ifdef AQUARIUS_X86_DISPATCH
+    if(size >= 32 && detectSimdLevel() == SimdLevel::AVX2) {
+        return findByteAVX2(ptr, size, set);
+    }
+#endif
+    return findByteBlock(ptr, size, set);
+}
+
+} // namespace simd
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_SIMD_HPP
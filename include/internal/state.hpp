@@ -18,10 +18,89 @@
 #define AQUARIUS_CXX_INTERNAL_STATE_HPP
 
 #include "misc.hpp"
+#include "memo.hpp"
+#include "unicode.hpp"
+#include "policy.hpp"
 
 namespace aquarius {
 
+/**
+ * result of void type expression. cursor is passed and returned by value, so it can be kept in register.
+ */
 template <typename RandomAccessIterator>
+struct MatchResult {
+    /**
+     * cursor after matching. if failed, position where cursor should be left
+     */
+    RandomAccessIterator pos;
+
+    bool success;
+};
+
+/**
+ * bytes expected at longest matched failure. if Enabled is false (see Policy::trackExpected), no storage
+ * and always empty.
+ */
+template <bool Enabled>
+struct ExpectedBytes {
+    unicode_util::ByteMap value;
+
+    void clear() {
+        this->value = unicode_util::ByteMap();
+    }
+
+    void add(unicode_util::ByteMap set) {
+        this->value = this->value + set;
+    }
+
+    const unicode_util::ByteMap &get() const {
+        return this->value;
+    }
+};
+
+template <>
+struct ExpectedBytes<false> {
+    void clear() { }
+
+    void add(unicode_util::ByteMap) { }
+
+    const unicode_util::ByteMap &get() const {
+        static const unicode_util::ByteMap empty;
+        return empty;
+    }
+};
+
+/**
+ * if Enabled is false (see Policy::trackEnd), no storage and always false.
+ */
+template <bool Enabled>
+struct EndFlag {
+    bool value{false};
+
+    void set() {
+        this->value = true;
+    }
+
+    bool get() const {
+        return this->value;
+    }
+};
+
+template <>
+struct EndFlag<false> {
+    void set() { }
+
+    bool get() const {
+        return false;
+    }
+};
+
+/**
+ * @tparam RandomAccessIterator
+ * @tparam Policy
+ * see policy.hpp
+ */
+template <typename RandomAccessIterator, typename Policy = DefaultPolicy>
 class ParserState {
 private:
     static_assert(misc::is_random_access_iter<RandomAccessIterator>::value, "require random access iterator");
@@ -40,13 +119,35 @@ private:
     bool result_;
 
     /**
-     * indicate longest matched failure
+     * if true, some expression failed due to lack of input.
+     * in other words, result may be changed if more input is available.
+     * only tracked if Policy::trackEnd is true (otherwise, empty and placed in padding after result_)
+     */
+    EndFlag<Policy::trackEnd> reachedEnd_;
+
+    /**
+     * bytes expected at longest matched failure. only collected if Policy::trackExpected is true
+     */
+    ExpectedBytes<Policy::trackExpected> expected_;
+
+    /**
+     * indicate longest matched failure. if Policy::trackFailure is false, always begin
      */
     RandomAccessIterator failure_;
 
+    /**
+     * for memoized rule. if Policy::useMemo is false, empty
+     */
+    typename std::conditional<Policy::useMemo, MemoTable, NoMemoTable>::type memoTable_;
+
+    Policy policy_;
+
 public:
+    using policyType = Policy;
+
     ParserState(RandomAccessIterator begin, RandomAccessIterator end) :
-            begin_(begin), end_(end), cursor_(begin), result_(true), failure_(begin) { }
+            begin_(begin), end_(end), cursor_(begin), result_(true), reachedEnd_(), expected_(), failure_(begin),
+            memoTable_(), policy_() { }
 
     RandomAccessIterator begin() const {
         return this->begin_;
@@ -70,15 +171,89 @@ public:
 
     void reportFailure() {
         this->result_ = false;
-        if(this->cursor_ > this->failure_) {
-            this->failure_ = this->cursor_;
+        this->reportFailureAt(this->cursor_);
+    }
+
+    /**
+     * report failure due to remaining input is shorter than required.
+     */
+    void reportShortInput() {
+        this->reportFailure();
+        this->reachedEnd_.set();
+    }
+
+    /**
+     * record failure position without changing result (for expression which has local cursor).
+     * @param pos
+     */
+    void reportFailureAt(RandomAccessIterator pos) {
+        this->updateFailure(pos);
+        if(Policy::trackEnd && pos == this->end_) {
+            this->reachedEnd_.set();
         }
     }
 
+    /**
+     * same as reportFailureAt(pos), but also record first bytes of expr as expected bytes.
+     * @param pos
+     * @param expr
+     * expression which failed at pos
+     */
+    template <typename T>
+    void reportFailureAt(RandomAccessIterator pos, const T &expr) {
+        this->reportFailureAt(pos);
+        this->expect(pos, expr);
+    }
+
+    void reportShortInputAt(RandomAccessIterator pos) {
+        this->reportFailureAt(pos);
+        this->reachedEnd_.set();
+    }
+
+    template <typename T>
+    void reportShortInputAt(RandomAccessIterator pos, const T &expr) {
+        this->reportShortInputAt(pos);
+        this->expect(pos, expr);
+    }
+
+    /**
+     *
+     * @return
+     * if Policy::trackEnd is false, always false
+     */
+    bool reachedEnd() const {
+        return this->reachedEnd_.get();
+    }
+
+    /**
+     *
+     * @return
+     * relative position of longest matched failure from cursor. if Policy::trackFailure is false, meaningless
+     */
     size_t failurePos() const {
         return std::distance(this->cursor_, this->failure_);
     }
 
+    RandomAccessIterator failure() const {
+        return this->failure_;
+    }
+
+    void updateFailure(RandomAccessIterator pos) {
+        if(Policy::trackFailure && pos > this->failure_) {
+            this->failure_ = pos;
+            this->expected_.clear();
+        }
+    }
+
+    /**
+     *
+     * @return
+     * if Policy::trackExpected is false, always empty
+     */
+    const unicode_util::ByteMap &expected() const {
+        return this->expected_.get();
+    }
+
     void setResult(bool set) {
         this->result_ = set;
     }
@@ -86,6 +261,52 @@ public:
     bool result() const {
         return this->result_;
     }
+
+    template <typename P = Policy, misc::enable_when<P::useMemo> = nullptr>
+    MemoTable &memoTable() {
+        return this->memoTable_;
+    }
+
+    template <typename P = Policy, misc::enable_when<P::useMemo> = nullptr>
+    const MemoTable &memoTable() const {
+        return this->memoTable_;
+    }
+
+    Policy &policy() {
+        return this->policy_;
+    }
+
+    const Policy &policy() const {
+        return this->policy_;
+    }
+
+    /**
+     * notify start of rule application (only if Policy::hookRule is true)
+     * @tparam T
+     * rule
+     * @param pos
+     */
+    template <typename T>
+    void enterRule(RandomAccessIterator pos) {
+        if(Policy::hookRule) {
+            this->policy_.enterRule(ruleId<T>(), misc::ruleName<T>(), std::distance(this->begin_, pos));
+        }
+    }
+
+    template <typename T>
+    void exitRule(RandomAccessIterator pos, bool success) {
+        if(Policy::hookRule) {
+            this->policy_.exitRule(ruleId<T>(), misc::ruleName<T>(), std::distance(this->begin_, pos), success);
+        }
+    }
+
+private:
+    template <typename T>
+    void expect(RandomAccessIterator pos, const T &expr) {
+        if(Policy::trackExpected && pos == this->failure_) {
+            this->expected_.add(expr.firstSet());
+        }
+    }
 };
 
 template <typename RandomAccessIterator>
@@ -93,6 +314,14 @@ inline ParserState<RandomAccessIterator> createState(RandomAccessIterator begin,
     return ParserState<RandomAccessIterator>(begin, end);
 }
 
+/**
+ * create state with policy. ex. createState<FastPolicy>(begin, end)
+ */
+template <typename Policy, typename RandomAccessIterator>
+inline ParserState<RandomAccessIterator, Policy> createState(RandomAccessIterator begin, RandomAccessIterator end) {
+    return ParserState<RandomAccessIterator, Policy>(begin, end);
+}
+
 } // namespace aquarius
 
 #endif //AQUARIUS_CXX_INTERNAL_STATE_HPP
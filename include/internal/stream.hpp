@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2016 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AQUARIUS_CXX_INTERNAL_STREAM_HPP
+#define AQUARIUS_CXX_INTERNAL_STREAM_HPP
+
+#include <string>
+
+#include "parser.hpp"
+
+namespace aquarius {
+
+enum class StreamStatus : unsigned char {
+    MATCHED,            // one record is parsed
+    NEED_MORE_INPUT,    // reached end of buffered input. feed more input or call finish()
+    FAILED,             // parse error. buffered input is not consumed
+    END,                // all of input is consumed after finish()
+};
+
+/**
+ * parse successive records of RULE from chunked input.
+ *
+ * only unconsumed input is buffered. if a rule application reaches end of buffered input,
+ * report NEED_MORE_INPUT and re-parse the current record from its beginning when more input is fed,
+ * so buffer size is bounded by record size (backtracking horizon of grammar), not by whole input size.
+ *
+ * by default, record is re-parsed whenever input is fed, so completed record is reported without delay.
+ * if a record arrives in many small chunks, total cost is quadratic to record size.
+ * if deferRetry is true, re-parsing is deferred until buffered input is doubled, so total cost is linear
+ * to input size. but completed record may be held until buffered input is doubled or finish() is called
+ * (ex. 100 bytes record fed as 60 + 40 bytes waits 20 more bytes), so do not use it for request/response protocol.
+ */
+template <typename RULE>
+class StreamParser {
+public:
+    using retType = typename Parser<RULE>::retType;
+
+private:
+    /**
+     * buffered input. [pos_, buffer_.size()) is unconsumed
+     */
+    std::string buffer_;
+
+    std::size_t pos_;
+
+    /**
+     * if unconsumed input is shorter than this, skip re-parse
+     */
+    std::size_t retrySize_;
+
+    bool finished_;
+
+    bool deferRetry_;
+
+public:
+    explicit StreamParser(bool deferRetry = false) :
+            buffer_(), pos_(0), retrySize_(0), finished_(false), deferRetry_(deferRetry) { }
+
+    /**
+     * append input. accept any input iterator (ex. std::istreambuf_iterator)
+     * @param begin
+     * @param end
+     */
+    template <typename Iterator>
+    void feed(Iterator begin, Iterator end) {
+        this->compact();
+        this->buffer_.append(begin, end);
+    }
+
+    void feed(const char *data, std::size_t size) {
+        this->feed(data, data + size);
+    }
+
+    /**
+     * indicate end of input.
+     */
+    void finish() {
+        this->finished_ = true;
+    }
+
+    bool finished() const {
+        return this->finished_;
+    }
+
+    /**
+     *
+     * @return
+     * size of currently buffered (unconsumed) input
+     */
+    std::size_t bufferedSize() const {
+        return this->buffer_.size() - this->pos_;
+    }
+
+    /**
+     * parse next record.
+     * @param result
+     * if return MATCHED, set parsed result
+     * @return
+     */
+    StreamStatus next(ParsedResult<retType> &result) {
+        const std::size_t size = this->bufferedSize();
+        if(size == 0 && this->finished_) {
+            return StreamStatus::END;
+        }
+        if(!this->finished_ && (size == 0 || size < this->retrySize_)) {
+            return StreamStatus::NEED_MORE_INPUT;
+        }
+
+        const char *begin = this->buffer_.data() + this->pos_;
+        auto state = createState(begin, begin + size);
+        static_assert(decltype(state)::policyType::trackEnd, "require end of input tracking");
+        auto r = Parser<RULE>()(state);
+        if(state.reachedEnd() && !this->finished_) {
+            this->retrySize_ = this->deferRetry_ ? size * 2 : size + 1;
+            return StreamStatus::NEED_MORE_INPUT;
+        }
+        this->retrySize_ = 0;
+        if(!r || state.consumedSize() == 0) {   // empty match is treated as failure (never progress)
+            return StreamStatus::FAILED;
+        }
+        this->pos_ += state.consumedSize();
+        result = std::move(r);
+        return StreamStatus::MATCHED;
+    }
+
+    /**
+     * parse all of records from input iterator. input is read by chunk.
+     * @param begin
+     * @param end
+     * @param func
+     * called with each parsed result (ParsedResult<retType> &&)
+     * @param chunkSize
+     * max size of input read at once. if 0, 4096
+     * @return
+     * END or FAILED
+     */
+    template <typename Iterator, typename Func>
+    StreamStatus parse(Iterator begin, Iterator end, Func func, std::size_t chunkSize = 4096) {
+        if(chunkSize == 0) {
+            chunkSize = 4096;
+        }
+        std::string chunk;
+        chunk.reserve(chunkSize);
+        while(true) {
+            ParsedResult<retType> result;
+            auto s = this->next(result);
+            switch(s) {
+            case StreamStatus::MATCHED:
+                func(std::move(result));
+                continue;
+            case StreamStatus::NEED_MORE_INPUT: {
+                chunk.clear();
+                for(; chunk.size() < chunkSize && begin != end; ++begin) {
+                    chunk += *begin;
+                }
+                if(chunk.empty()) {
+                    this->finish();
+                } else {
+                    this->feed(chunk.data(), chunk.size());
+                }
+                continue;
+            }
+            case StreamStatus::FAILED:
+            case StreamStatus::END:
+                return s;
+            }
+        }
+    }
+
+private:
+    /**
+     * remove consumed input
+     */
+    void compact() {
+        if(this->pos_ > 0 && this->pos_ * 2 >= this->buffer_.size()) {
+            this->buffer_.erase(0, this->pos_);
+            this->pos_ = 0;
+        }
+    }
+};
+
+} // namespace aquarius
+
+#endif //AQUARIUS_CXX_INTERNAL_STREAM_HPP
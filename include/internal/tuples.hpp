@@ -19,6 +19,7 @@
 
 #include <tuple>
 #include <memory>
+#include <initializer_list>
 
 #include "misc.hpp"
 
@@ -57,6 +58,87 @@ inline auto catAsTuple(L &&l, R &&r) {
 }
 
 
+/**
+ * convert value type to tuple type. void is empty tuple, and tuple is itself.
+ */
+template <typename T>
+struct as_tuple {
+    using type = std::tuple<T>;
+};
+
+template <>
+struct as_tuple<void> {
+    using type = std::tuple<>;
+};
+
+template <typename ... A>
+struct as_tuple<std::tuple<A ...>> {
+    using type = std::tuple<A ...>;
+};
+
+template <typename T>
+using as_tuple_t = typename as_tuple<T>::type;
+
+/**
+ * number of elements which value type occupies in concatenated tuple
+ */
+template <typename T>
+struct value_width : std::tuple_size<as_tuple_t<T>> { };
+
+template <typename ... T>
+struct count_non_void : std::integral_constant<std::size_t, 0> { };
+
+template <typename F, typename ... T>
+struct count_non_void<F, T ...> :
+        std::integral_constant<std::size_t, (std::is_void<F>::value ? 0 : 1) + count_non_void<T ...>::value> { };
+
+template <typename ... T>
+struct first_non_void {
+    using type = void;
+};
+
+template <typename F, typename ... T>
+struct first_non_void<F, T ...> {
+    using type = std::conditional_t<std::is_void<F>::value, typename first_non_void<T ...>::type, F>;
+};
+
+/**
+ * result type of concatenating values (void is ignored).
+ * if all of types are void, void. if only one type is not void, it.
+ * otherwise, flattened tuple (same as result of repeated catAsTuple).
+ */
+template <typename ... T>
+struct cat_type {
+    using type = std::conditional_t<(count_non_void<T ...>::value < 2),
+            typename first_non_void<T ...>::type,
+            decltype(std::tuple_cat(std::declval<as_tuple_t<T>>()...))>;
+};
+
+template <typename ... T>
+using cat_type_t = typename cat_type<T ...>::type;
+
+constexpr bool allOf(std::initializer_list<bool> list) {
+    for(bool b : list) {
+        if(!b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * get elements in [Begin, End) of tuple
+ */
+template <std::size_t Begin, typename ... T, size_t ... I>
+constexpr auto sliceTupleImpl(const std::tuple<T ...> &tuple, std::index_sequence<I ...>) {
+    return std::make_tuple(std::get<Begin + I>(tuple)...);
+}
+
+template <std::size_t Begin, std::size_t End, typename ... T>
+constexpr auto sliceTuple(const std::tuple<T ...> &tuple) {
+    return sliceTupleImpl<Begin>(tuple, std::make_index_sequence<End - Begin>());
+}
+
 /**
  * apply function with tuple argument.
  */
@@ -147,6 +229,24 @@ inline auto unpackAndConstruct() {
     return construct<T>();
 }
 
+/**
+ * construct object in allocator (ex. Arena) with tuple argument.
+ */
+template <typename T, typename Alloc, typename ... A, size_t ... I>
+inline auto unpackAndCreateImpl(Alloc &alloc, std::tuple<A ...> &&tuple, std::index_sequence<I...>) {
+    return alloc.template create<T>(std::get<I>(std::move(tuple))...);
+}
+
+template <typename T, typename Alloc, typename ... A>
+inline auto unpackAndCreate(Alloc &alloc, std::tuple<A ...> &&tuple) {
+    return unpackAndCreateImpl<T>(alloc, std::move(tuple), std::make_index_sequence<sizeof...(A)>());
+}
+
+template <typename T, typename Alloc, typename A>
+inline auto unpackAndCreate(Alloc &alloc, A &&arg) {
+    return alloc.template create<T>(std::forward<A>(arg));
+}
+
 } // namespace misc
 } // namespace aquarius
 
@@ -54,6 +54,84 @@ struct AsciiMap {
     }
 };
 
+/**
+ * set of bytes (0 - 255). used for first byte set of expression.
+ */
+struct ByteMap {
+    std::uint64_t map[4];
+
+    constexpr ByteMap() : map{0, 0, 0, 0} { }
+
+    constexpr ByteMap(std::uint64_t m0, std::uint64_t m1, std::uint64_t m2, std::uint64_t m3) :
+            map{m0, m1, m2, m3} { }
+
+    constexpr explicit ByteMap(AsciiMap asciiMap) : map{asciiMap.map[0], asciiMap.map[1], 0, 0} { }
+
+    static constexpr ByteMap full() {
+        return ByteMap(~static_cast<std::uint64_t>(0), ~static_cast<std::uint64_t>(0),
+                       ~static_cast<std::uint64_t>(0), ~static_cast<std::uint64_t>(0));
+    }
+
+    constexpr ByteMap operator+(ByteMap byteMap) const {
+        return {this->map[0] | byteMap.map[0], this->map[1] | byteMap.map[1],
+                this->map[2] | byteMap.map[2], this->map[3] | byteMap.map[3]};
+    }
+
+    constexpr ByteMap operator+(unsigned char b) const {
+        ByteMap byteMap = *this;
+        byteMap.map[b / 64] |= static_cast<std::uint64_t>(1) << (b % 64);
+        return byteMap;
+    }
+
+    /**
+     * add bytes in [start, stop]
+     * @param start
+     * @param stop
+     * @return
+     */
+    constexpr ByteMap addRange(unsigned int start, unsigned int stop) const {
+        ByteMap byteMap = *this;
+        for(unsigned int b = start; b <= stop && b < 256; b++) {
+            byteMap = byteMap + static_cast<unsigned char>(b);
+        }
+        return byteMap;
+    }
+
+    constexpr bool contains(unsigned char b) const {
+        return (this->map[b / 64] >> (b % 64)) & 1u;
+    }
+
+    constexpr bool isDisjoint(ByteMap byteMap) const {
+        return (this->map[0] & byteMap.map[0]) == 0 && (this->map[1] & byteMap.map[1]) == 0 &&
+               (this->map[2] & byteMap.map[2]) == 0 && (this->map[3] & byteMap.map[3]) == 0;
+    }
+};
+
+/**
+ * get set of first bytes of utf8 encoded code points in [start, stop].
+ * include overlong form (decoder accepts it).
+ * @param start
+ * @param stop
+ * @return
+ */
+constexpr ByteMap utf8LeadBytes(char32_t start, char32_t stop) {
+    // (max code point, prefix of first byte, shift) of 1 - 4 byte encoding
+    const std::uint32_t table[4][3] = {
+            {0x7F,     0x00, 0},
+            {0x7FF,    0xC0, 6},
+            {0xFFFF,   0xE0, 12},
+            {0x1FFFFF, 0xF0, 18},
+    };
+    ByteMap byteMap;
+    for(auto &e : table) {
+        if(start <= stop && start <= e[0]) {
+            const std::uint32_t last = stop < e[0] ? stop : e[0];
+            byteMap = byteMap.addRange(e[1] | (start >> e[2]), e[1] | (last >> e[2]));
+        }
+    }
+    return byteMap;
+}
+
 constexpr AsciiMap makeFromRange(AsciiMap asciiMap, char start, char stop) {
     return start < stop ? makeFromRange(asciiMap + start, start + 1, stop) : asciiMap + start;
 }
@@ -0,0 +1,182 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <aquarius.hpp>
+
+namespace node {
+
+using aquarius::ArenaPtr;
+
+struct Node {
+    static int live;
+
+    Node() {
+        live++;
+    }
+
+    virtual ~Node() {
+        live--;
+    }
+};
+
+int Node::live = 0;
+
+struct Leaf : Node {
+    std::string value;
+
+    explicit Leaf(std::string &&value) : value(std::move(value)) { }
+};
+
+struct Bang : Node {
+    ArenaPtr<Leaf> leaf;
+
+    explicit Bang(ArenaPtr<Leaf> &&leaf) : leaf(leaf) { }
+};
+
+struct List : Node {
+    std::vector<ArenaPtr<Node>> items;
+};
+
+struct Append {
+    void operator()(ArenaPtr<List> &list, ArenaPtr<Node> &&item) const {
+        list->items.push_back(item);
+    }
+};
+
+}
+
+namespace rule {
+
+using namespace aquarius;
+using namespace aquarius::ascii;
+
+AQ_DEFINE_RULE(Leaf, ArenaPtr<node::Leaf>) {
+    return text[ +set("0-9") ] >> allocate<node::Leaf>();
+}
+
+AQ_DECL_RULE(List, ArenaPtr<node::List>);
+
+AQ_DEFINE_RULE(Item, ArenaPtr<node::Node>) {
+    return nterm<Leaf>() >> ch('!') >> allocate<node::Bang>() >> cast<ArenaPtr<node::Node>>()
+           | nterm<Leaf>() >> cast<ArenaPtr<node::Node>>()
+           | nterm<List>() >> cast<ArenaPtr<node::Node>>();
+}
+
+AQ_DEFINE_RULE(List, ArenaPtr<node::List>) {
+    return ch('(') >> allocate<node::List>() >> join_each0<node::Append>(nterm<Item>(), ch(',')) >> ch(')');
+}
+
+AQ_DEFINE_RULE(Leaves, std::vector<ArenaPtr<node::Leaf>>) {
+    return *(nterm<Leaf>() >> ch(';'));
+}
+
+AQ_DEFINE_RULE(OptBang, Optional<ArenaPtr<node::Bang>>) {
+    return -(nterm<Leaf>() >> ch('!') >> allocate<node::Bang>());
+}
+
+}
+
+using namespace aquarius;
+
+TEST(arena, allocate) {
+    Arena arena;
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, arena.blockCount()));
+
+    auto *p1 = static_cast<char *>(arena.allocate(1, 1));
+    auto *p2 = static_cast<char *>(arena.allocate(8, 8));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, arena.blockCount()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, reinterpret_cast<std::uintptr_t>(p2) % 8));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(p2 > p1));
+
+    auto i = arena.create<int>(12);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(12, *i));
+
+    // larger than block
+    auto *p3 = arena.allocate(Arena::BLOCK_SIZE * 3);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(p3 != nullptr));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, arena.blockCount()));
+
+    // reuse blocks
+    const std::size_t capacity = arena.capacity();
+    arena.clear();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(p1, arena.allocate(1, 1)));
+    arena.allocate(Arena::BLOCK_SIZE * 2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(capacity, arena.capacity()));
+
+    Arena arena2(std::move(arena));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, arena.blockCount()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, arena2.blockCount()));
+}
+
+TEST(arena, rollback) {
+    Arena arena;
+    {
+        auto l1 = arena.create<node::Leaf>("1");
+        const auto c = arena.checkpoint();
+        auto l2 = arena.create<node::Leaf>("2");
+        arena.create<node::Leaf>("3");
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3, node::Node::live));
+
+        arena.rollback(c);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1, node::Node::live));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1", l1->value));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(arena.create<node::Leaf>("4") == l2));  // reuse memory
+    }
+    arena.clear();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, node::Node::live));
+
+    // destroyed by destructor
+    {
+        Arena arena2;
+        arena2.create<node::Leaf>("5");
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1, node::Node::live));
+    }
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, node::Node::live));
+}
+
+TEST(arena, parse) {
+    Arena arena;
+    std::string input("(1,2!,(3))");
+    auto r = Parser<rule::List>()(input.begin(), input.end(), arena);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    auto &list = r.get();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, list->items.size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1", static_cast<node::Leaf *>(list->items[0].get())->value));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("2", static_cast<node::Bang *>(list->items[1].get())->leaf->value));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, static_cast<node::List *>(list->items[2].get())->items.size()));
+
+    // leaves allocated by failed alternatives are rolled back
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(6, node::Node::live));
+
+    arena.clear();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, node::Node::live));
+
+    // failed choice
+    input = "(1,x";
+    auto r2 = Parser<rule::Item>()(input.begin(), input.end(), arena);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r2)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, node::Node::live));
+
+    // failed repetition
+    input = "1;2;3";
+    auto r3 = Parser<rule::Leaves>()(input.begin(), input.end(), arena);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r3)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, r3.get().size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2, node::Node::live));
+    arena.clear();
+
+    // failed option
+    input = "1";
+    auto r4 = Parser<rule::OptBang>()(input.begin(), input.end(), arena);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r4)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r4.get())));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, node::Node::live));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
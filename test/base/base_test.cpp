@@ -1,5 +1,7 @@
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <deque>
 
 #include "gtest/gtest.h"
 
@@ -190,6 +192,33 @@ TEST(base, string3) {
     ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(6u, state.failurePos()));
 }
 
+TEST(base, string4) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    constexpr auto p = str("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJ");
+    check_unit(p);
+
+    const char *input = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJ!";
+    auto state = createState(input, input + strlen(input));
+
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(46u, state.consumedSize()));
+
+    // failed case
+    for(unsigned int i : {0u, 7u, 8u, 15u, 16u, 31u, 32u, 45u}) {
+        std::string str("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJ");
+        str[i] = '@';
+        auto state2 = createState(str.cbegin(), str.cend());
+
+        p(state2);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state2.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state2.consumedSize()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(i, state2.failurePos()));
+    }
+}
+
 TEST(base, charClass1) {
     using namespace aquarius;
 
@@ -429,6 +458,80 @@ TEST(base, charClass7) {
     ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.failurePos()));
 }
 
+TEST(base, skipUntil) {
+    using namespace aquarius;
+
+    constexpr auto p = skip_until("\"\\");
+    check_unit(p);
+    static_assert(p.nullable(), "");
+    static_assert(!p.firstSet().contains('"') && p.firstSet().contains('a') && p.firstSet().contains(0xE3), "");
+
+    std::string input("abc \xE3\x81\x82\"");
+    auto state = createState(input.begin(), input.end());
+
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(7u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.reachedEnd()));
+
+    // stop at delimiter
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(7u, state.consumedSize()));
+
+    // long input (searched by block). delimiter at each position
+    for(std::size_t i = 0; i < 100; i++) {
+        input = std::string(i, 'x') + "\\" + std::string(50, 'y');
+        state = createState(input.begin(), input.end());
+
+        p(state);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(i, state.consumedSize()));
+    }
+
+    // reach end
+    input = std::string(70, 'z');
+    state = createState(input.begin(), input.end());
+
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(70u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.reachedEnd()));
+
+    // single delimiter
+    constexpr auto p2 = skip_until("\n");
+    input = "hello\nworld\n";
+    state = createState(input.begin(), input.end());
+
+    p2(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state.consumedSize()));
+
+    // non contiguous input
+    std::deque<char> deque(input.begin(), input.end());
+    auto state2 = createState(deque.begin(), deque.end());
+
+    p2(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state2.consumedSize()));
+
+    // string body
+    constexpr auto p3 = ch('"') >> skip_until("\"\\") >> *(ch('\\') >> ascii::ANY >> skip_until("\"\\")) >> ch('"');
+    input = "\"ab\\\"c\\\\\"";
+    state = createState(input.begin(), input.end());
+
+    p3(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(input.size(), state.consumedSize()));
+
+    input = "\"abc";
+    state = createState(input.begin(), input.end());
+
+    p3(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.reachedEnd()));
+}
+
 TEST(base, andPredicate) {
     using namespace aquarius;
     using namespace ascii;
@@ -511,6 +614,53 @@ TEST(base, capture) {
     });
 }
 
+struct ViewLength {
+    std::size_t operator()(aquarius::StringView &&v) const {
+        return v.size();
+    }
+};
+
+TEST(base, view) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    constexpr auto p = view[ str("hello") ] >> ch(' ') >> view[ *set("a-z") ];
+    check_same<std::tuple<StringView, StringView>>(p);
+
+    std::string input("hello world!!");
+    auto state = createState(input.cbegin(), input.cend());
+    auto r = p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(11u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(input.data(), std::get<0>(r).data()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("hello", std::get<0>(r).toString()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("world", std::get<1>(r).toString()));
+
+    // with mapper
+    constexpr auto p2 = view[ +set("0-9") ] >> construct<std::string>();
+    check_same<std::string>(p2);
+    constexpr auto p3 = view[ +set("0-9") ] >> map<ViewLength>();
+    check_same<std::size_t>(p3);
+
+    const char *input2 = "1234a";
+    auto state2 = createState(input2, input2 + strlen(input2));
+    auto r2 = p2(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1234", r2));
+
+    state2 = createState(input2, input2 + strlen(input2));
+    auto r3 = p3(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, r3));
+
+    // failed case
+    input = "hello";
+    state = createState(input.cbegin(), input.cend());
+    r = p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+}
+
 TEST(base, zeroMore1) {
     using namespace aquarius;
 
@@ -657,6 +807,45 @@ TEST(base, repeat1) {
     ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.consumedSize()));
 }
 
+TEST(base, repeat3) {
+    using namespace aquarius;
+
+    constexpr auto p = repeat<3, 40>(set(" \t0-9"));
+    check_unit(p);
+
+    for(unsigned int i : {0u, 2u, 3u, 15u, 16u, 17u, 31u, 32u, 33u, 39u, 40u, 41u, 100u}) {
+        std::string input(i, ' ');
+        for(unsigned int j = 0; j < i; j += 3) {
+            input[j] = static_cast<char>('0' + j % 10);
+        }
+        input += static_cast<char>(0xE3);   // non-ascii
+        input += std::string(70, ' ');
+
+        const bool success = i >= 3;
+        const std::size_t consumed = i < 40 ? i : 40;
+
+        auto state = createState(input.begin(), input.end());
+        p(state);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(success, state.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(consumed, state.consumedSize()));
+
+        // not contiguous
+        std::deque<char> deque(input.begin(), input.end());
+        auto state2 = createState(deque.begin(), deque.end());
+        p(state2);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(success, state2.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(consumed, state2.consumedSize()));
+    }
+
+    // end of input
+    std::string input(20, '\t');
+    auto state = createState(input.c_str(), input.c_str() + input.size());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(20u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.failurePos()));
+}
+
 TEST(base, repeat2) {
     using namespace aquarius;
 
@@ -741,6 +930,60 @@ TEST(base, option2) {
     ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(result)));
 }
 
+struct Counted {
+    static int count;
+
+    int value;
+
+    explicit Counted(int value) : value(value) {
+        count++;
+    }
+
+    Counted(Counted &&o) noexcept : value(o.value) {
+        count++;
+    }
+
+    Counted &operator=(Counted &&o) noexcept = default;
+
+    ~Counted() {
+        count--;
+    }
+};
+
+int Counted::count = 0;
+
+TEST(base, optional) {
+    using namespace aquarius;
+
+    {
+        Optional<Counted> o1;
+        ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(o1)));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, Counted::count));
+
+        o1.emplace(12);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(o1)));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(12, o1.get().value));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1, Counted::count));
+
+        Optional<Counted> o2(std::move(o1));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(o1)));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(o2)));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(12, o2.get().value));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1, Counted::count));
+
+        o1.emplace(34);
+        o1.swap(o2);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(12, o1.get().value));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(34, o2.get().value));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2, Counted::count));
+
+        o2 = Optional<Counted>();
+        ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(o2)));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1, Counted::count));
+    }
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, Counted::count));
+}
+
 TEST(base, seq1) {
     using namespace aquarius;
     using namespace ascii;
@@ -944,6 +1187,427 @@ TEST(base, choice) {
     ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
 }
 
+TEST(base, firstSet) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    constexpr auto p1 = str("world") | str("he") >> str("llo");
+    static_assert(p1.firstSet().contains('w') && p1.firstSet().contains('h'), "");
+    static_assert(!p1.firstSet().contains('x') && !p1.nullable(), "");
+
+    constexpr auto p2 = *ch(' ') >> -set("+-") >> set("0-9");
+    static_assert(p2.firstSet().contains(' ') && p2.firstSet().contains('+') && p2.firstSet().contains('5'), "");
+    static_assert(!p2.firstSet().contains('a') && !p2.nullable(), "");
+
+    constexpr auto p3 = !ch('"') >> ANY;
+    static_assert(!p3.firstSet().contains('"') && p3.firstSet().contains('a'), "");
+    static_assert(!p3.firstSet().contains(static_cast<unsigned char>(0x80)), "");
+
+    constexpr auto p4 = unicode::set(U"あ-んa");
+    static_assert(p4.firstSet().contains(0xE3) && p4.firstSet().contains('a') && !p4.firstSet().contains('b'), "");
+}
+
+TEST(base, choice2) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    // overlapped first set
+    constexpr auto p = str("ab") | str("ac") | ch('a');
+
+    std::string input("ac");
+    auto state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.consumedSize()));
+
+    input = "ad";
+    state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1, std::distance(state.begin(), state.failure())));
+
+    // all alternatives are skipped
+    input = "xa";
+    state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.failurePos()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.reachedEnd()));
+
+    // end of input
+    constexpr auto p2 = text[ str("ab") ] | text[ EMPTY ];
+    input = "";
+    state = createState(input.begin(), input.end());
+    auto r = p2(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(r.empty()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.reachedEnd()));
+}
+
+TEST(base, flatten) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    // nested sequence is flattened into single node
+    constexpr auto p = (text[ str("a") ] >> ch(',')) >> (text[ str("b") ] >> (ch(',') >> text[ str("c") ]));
+    check_same<std::tuple<std::string, std::string, std::string>>(p);
+    static_assert(std::tuple_size<decltype(p.exprs)>::value == 5, "must be flattened");
+
+    std::string input("a,b,c");
+    auto state = createState(input.begin(), input.end());
+    auto r = p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("a", std::get<0>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("b", std::get<1>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("c", std::get<2>(r)));
+
+    // cursor is restored to start of sequence
+    input = "a,b,";
+    state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4, std::distance(state.begin(), state.failure())));
+
+    // nested choice is flattened into single node
+    constexpr auto p2 = str("xx") | (str("yy") | (str("zz") | str("ww")));
+    check_unit(p2);
+    static_assert(std::tuple_size<decltype(p2.exprs)>::value == 4, "must be flattened");
+
+    input = "ww";
+    state = createState(input.begin(), input.end());
+    p2(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.consumedSize()));
+}
+
+TEST(base, peephole) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    // sequence of char => inline string
+    constexpr auto p = ch('a') >> ch('b') >> (ch('c') >> ch('d'));
+    static_assert(std::is_same<const expression::CharString<4>, decltype(p)>::value, "must be fused");
+    static_assert(p.firstSet().contains('a') && !p.nullable(), "");
+
+    std::string input("abcd");
+    auto state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, state.consumedSize()));
+
+    // failure is reported at first mismatch
+    input = "abx";
+    state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.failurePos()));
+
+    input = "ab";
+    std::deque<char> deque(input.begin(), input.end());
+    auto state2 = createState(deque.begin(), deque.end());
+    p(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state2.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state2.failurePos()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.reachedEnd()));
+
+    // fused only adjacent chars
+    constexpr auto p2 = ch('[') >> ch(' ') >> *ch(' ') >> ch(']') >> ch(';');
+    static_assert(std::tuple_size<decltype(p2.exprs)>::value == 3, "must be fused");
+
+    input = "[  ];";
+    state = createState(input.begin(), input.end());
+    p2(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state.consumedSize()));
+
+    // choice of char/char class => char class
+    constexpr auto p3 = ch('+') | set("0-9") | ch('-');
+    static_assert(std::is_same<const expression::CharClass, decltype(p3)>::value, "must be fused");
+
+    constexpr auto p4 = ch('x') | str("yz") | ch('a') | ch('b');
+    static_assert(std::tuple_size<decltype(p4.exprs)>::value == 3, "must be fused");
+
+    input = "b";
+    state = createState(input.begin(), input.end());
+    p4(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state.consumedSize()));
+
+    // !set(X) >> ANY => negated char class
+    constexpr auto p5 = !set("\\\"") >> ANY;
+    static_assert(std::is_same<const expression::CharClass, decltype(p5)>::value, "must be fused");
+    static_assert(p5.firstSet().contains('a') && !p5.firstSet().contains('"'), "");
+
+    for(const char *s : {"a", "\\", "\"", "\xE3"}) {
+        input = s;
+        state = createState(input.begin(), input.end());
+        p5(state);
+        const bool success = s[0] == 'a';
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(success, state.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(success ? 1u : 0u, state.consumedSize()));
+    }
+
+    // !!!e => !e
+    constexpr auto p6 = !!!ch('a');
+    static_assert(std::is_same<const expression::NotPredicate<expression::Char>, decltype(p6)>::value, "");
+
+    // repeat<N, N> of fixed width expression => single bounds check
+    constexpr auto p7 = repeat<4, 4>(set("0-9a-fA-F"));
+    static_assert(std::is_same<const expression::RepeatFixed<expression::CharClass, 4>, decltype(p7)>::value, "");
+    check_unit(p7);
+
+    input = "12aF5";
+    state = createState(input.begin(), input.end());
+    p7(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, state.consumedSize()));
+
+    input = "12x45";
+    state = createState(input.begin(), input.end());
+    p7(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2, std::distance(state.begin(), state.failure())));
+
+    input = "12a";
+    state = createState(input.begin(), input.end());
+    p7(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3, std::distance(state.begin(), state.failure())));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.reachedEnd()));
+
+    constexpr auto p8 = repeat<2, 2>(str("ab"));
+    input = "ababab";
+    state = createState(input.begin(), input.end());
+    p8(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, state.consumedSize()));
+}
+
+TEST(base, leftFactoring) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    // shared prefix is matched once
+    constexpr auto integer = ch('0') | set("1-9") >> *set("0-9");
+    constexpr auto p = -ch('-') >> integer >> ch('.') >> +set("0-9") | -ch('-') >> integer;
+    static_assert(misc::is_specialization_of<std::remove_const_t<decltype(p)>, expression::FactoredChoice>::value,
+                  "must be factored");
+    static_assert(p.shared && p.firstSet().contains('-') && p.firstSet().contains('7') && !p.nullable(), "");
+    check_unit(p);
+
+    const char *inputs[] = {"-12.5", "12", "0.", "-x", ".5"};
+    const bool results[] = {true, true, true, false, false};
+    const std::size_t sizes[] = {5, 2, 1, 0, 0};
+    for(unsigned int i = 0; i < 5; i++) {
+        std::string input(inputs[i]);
+        auto state = createState(input.begin(), input.end());
+        p(state);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(results[i], state.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(sizes[i], state.consumedSize()));
+    }
+
+    // prefix is same in type, but different in value
+    constexpr auto p2 = -ch('+') >> integer >> ch('.') | -ch('-') >> integer;
+    static_assert(!p2.shared, "");
+
+    std::string input("-1");
+    auto state = createState(input.begin(), input.end());
+    p2(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.consumedSize()));
+
+    // three alternatives
+    constexpr auto p3 = *ch(' ') >> ch('a') | *ch(' ') >> ch('b') | *ch(' ') >> ch('c');
+    static_assert(p3.shared && std::tuple_size<decltype(p3.choice.exprs)>::value == 3, "");
+
+    input = "  c";
+    state = createState(input.begin(), input.end());
+    p3(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, state.consumedSize()));
+
+    input = "  d";
+    state = createState(input.begin(), input.end());
+    p3(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2, std::distance(state.begin(), state.failure())));
+
+    // single token prefix is not factored
+    constexpr auto p4 = ch('a') >> ch(',') >> *ch(' ') | ch('a') >> ch(';');
+    static_assert(expression::is_choice<std::remove_const_t<decltype(p4)>>::value, "");
+
+    // value type
+    constexpr auto p5 = -ch('-') >> text[ integer ] >> ch('.') | -ch('-') >> text[ integer ];
+    static_assert(p5.shared, "");
+    check_same<std::string>(p5);
+
+    input = "-12";
+    state = createState(input.begin(), input.end());
+    auto r = p5(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("12", r));
+
+    input = "3.";
+    state = createState(input.begin(), input.end());
+    r = p5(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("3", r));
+
+    input = "-";
+    state = createState(input.begin(), input.end());
+    p5(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+
+    // suffix which fails after consuming input. next suffix starts at end of prefix
+    constexpr auto p6 = +ch('a') >> repeat<3, 3>(ch('b')) | +ch('a') >> ch('b') >> ch('c');
+    static_assert(p6.shared, "");
+
+    input = "abc";
+    state = createState(input.begin(), input.end());
+    p6(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, state.consumedSize()));
+
+    constexpr auto p7 = +ch('a') >> text[ repeat<3, 3>(ch('b')) ] | +ch('a') >> text[ ch('b') >> ch('c') ];
+    static_assert(p7.shared, "");
+    state = createState(input.begin(), input.end());
+    r = p7(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("bc", r));
+
+    // prefix which fails after consuming input. cursor is left at same position as original choice
+    constexpr auto p8 = repeat<2, 3>(ch('a')) >> ch('x') | repeat<2, 3>(ch('a')) >> ch('y');
+    static_assert(p8.shared, "");
+    for(const char *s : {"ab", "aax", "aaay", "aaaa", "b"}) {
+        SCOPED_TRACE(s);
+        input = s;
+        state = createState(input.begin(), input.end());
+        p8(state);
+        auto state2 = createState(input.begin(), input.end());
+        p8.choice(state2);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(state2.result(), state.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(state2.consumedSize(), state.consumedSize()));
+    }
+}
+
+struct FastEndPolicy : aquarius::FastPolicy {
+    static constexpr bool trackEnd = true;
+};
+
+TEST(base, length) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    constexpr auto hex = set("0-9a-f");
+    constexpr auto uuid = repeat<8, 8>(hex) >> ch('-') >> repeat<4, 4>(hex) >> ch('-') >> repeat<4, 4>(hex) >>
+                          ch('-') >> repeat<4, 4>(hex) >> ch('-') >> repeat<12, 12>(hex);
+    static_assert(uuid.minLength() == 36 && uuid.maxLength() == 36 && uuid.width() == 36, "");
+    check_unit(uuid);
+
+    constexpr auto p = (str("true") | str("false")) >> repeat<0, 2>(ch(' '), ch(',')) >> -unicode::ch(U'あ');
+    static_assert(p.minLength() == 4 && p.maxLength() == 5 + 3 + 4, "");
+
+    constexpr auto p2 = text[ +set("0-9") >> !ch('.') ];
+    static_assert(p2.minLength() == 1 && p2.maxLength() == expression::INFINITE_LENGTH, "");
+
+    // fixed width sequence is matched with single bounds check
+    std::string input("123e4567-e89b-12d3-a456-426614174000");
+    auto state = createState(input.begin(), input.end());
+    uuid(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(36u, state.consumedSize()));
+
+    input = "123e4567-e89b-12d3-x456-426614174000";
+    state = createState(input.begin(), input.end());
+    uuid(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(19u, state.failurePos()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.reachedEnd()));
+
+    // short input is reported at same position as usual
+    input = "123e4567-e89b-x";
+    std::deque<char> deque(input.begin(), input.end());
+    auto state2 = createState(deque.begin(), deque.end());
+    uuid(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state2.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(14u, state2.failurePos()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state2.reachedEnd()));
+
+    // if failure is not tracked, short input fails without matching whole sequence
+    input = "12:34";
+    auto state3 = createState<FastPolicy>(input.begin(), input.end());
+    constexpr auto time = repeat<2, 2>(set("0-9")) >> ch(':') >> repeat<2, 2>(set("0-9")) >> ch(':') >>
+                          repeat<2, 2>(set("0-9")) >> -(ch('.') >> +set("0-9"));
+    static_assert(time.minLength() == 8, "");
+    time(state3);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state3.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state3.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state3.reachedEnd()));   // not tracked
+
+    auto state4 = createState<FastEndPolicy>(input.begin(), input.end());
+    time(state4);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state4.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state4.reachedEnd()));
+
+    // repetition is stopped at same position as usual
+    constexpr auto p3 = *(repeat<3, 3>(ch('a') | ch('b')) >> ch(';'));
+    for(const char *s : {"aab;ab", "aa", "aba;bbb;a"}) {
+        input = s;
+        state = createState(input.begin(), input.end());
+        p3(state);
+        state3 = createState<FastPolicy>(input.begin(), input.end());
+        p3(state3);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state3.result()));
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(state.consumedSize(), state3.consumedSize()));
+    }
+}
+
+TEST(base, match) {
+    using namespace aquarius;
+    using namespace ascii;
+
+    constexpr auto p = *ch(' ') >> (str("true") | str("false")) >> !set("a-z");
+
+    std::string input("  false;");
+    auto state = createState(input.begin(), input.end());
+    auto r = p.match(state.begin(), state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(r.success));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(7, std::distance(state.begin(), r.pos)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));  // state cursor is not used
+
+    // failure position is recorded in state
+    input = "  falsex;";
+    state = createState(input.begin(), input.end());
+    r = p.match(state.begin(), state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(r.success));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(r.pos == state.begin()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(8, std::distance(state.begin(), state.failure())));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.result()));
+
+    // same result as operator()
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.reachedEnd()));
+
+    input = "  fal";
+    state = createState(input.begin(), input.end());
+    p(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.result()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.reachedEnd()));
+}
+
 struct Sum {
     int operator()(std::string &&a, std::string &&b) const {
         int x = std::stoi(a);
@@ -1133,6 +1797,70 @@ TEST(base, nterm2) {
     ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
 }
 
+namespace memo {
+
+using namespace aquarius;
+
+AQ_DEFINE_MEMO_RULE(Digits, void) {
+    return +set("0-9");
+}
+
+// memoized rule is not left factored, since re-matching of it is memo table lookup
+AQ_DEFINE_RULE(Alt, void) {
+    return nterm<Digits>() >> ch('a') | nterm<Digits>() >> ch('b') | nterm<Digits>();
+}
+
+AQ_DEFINE_RULE(Factored, void) {
+    return nterm<Digits>() >> *ch(' ') >> ch('a') | nterm<Digits>() >> *ch(' ') >> ch('b') | nterm<Digits>();
+}
+
+struct NoMemoPolicy : PolicyBase {
+    static constexpr bool useMemo = false;
+};
+
+}
+
+TEST(base, memo) {
+    using namespace memo;
+    using namespace aquarius;
+
+    std::string input("1234b");
+    auto state = createState(input.begin(), input.end());
+    auto r = Parser<Alt>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state.memoTable().size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.memoTable().lookupCount()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state.memoTable().hitCount()));
+
+    // failed case
+    input = "x";
+    state = createState(input.begin(), input.end());
+    r = Parser<Alt>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state.memoTable().size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, state.memoTable().lookupCount()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, state.memoTable().hitCount()));
+
+    // shared prefix including memoized rule is applied once
+    input = "1234b";
+    state = createState(input.begin(), input.end());
+    r = Parser<Factored>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state.memoTable().lookupCount()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, state.memoTable().hitCount()));
+
+    // memoization is disabled by policy
+    input = "1234b";
+    auto state2 = createState<NoMemoPolicy>(input.begin(), input.end());
+    static_assert(sizeof(state2) < sizeof(state), "");
+    r = Parser<Alt>()(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, state2.consumedSize()));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
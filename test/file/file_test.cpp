@@ -0,0 +1,111 @@
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include <aquarius.hpp>
+
+using namespace aquarius;
+
+class FileTest : public ::testing::Test {
+protected:
+    std::string fileName;
+
+    void SetUp() override {
+        char name[] = "/tmp/aquarius_file_testXXXXXX";
+        int fd = mkstemp(name);
+        ASSERT_TRUE(fd > -1);
+        close(fd);
+        this->fileName = name;
+    }
+
+    void TearDown() override {
+        unlink(this->fileName.c_str());
+    }
+
+    void write(const std::string &content) {
+        FILE *fp = fopen(this->fileName.c_str(), "wb");
+        ASSERT_TRUE(fp != nullptr);
+        fwrite(content.data(), sizeof(char), content.size(), fp);
+        fclose(fp);
+    }
+};
+
+namespace rule {
+
+using namespace aquarius;
+
+AQ_DEFINE_RULE(Lines, void) {
+    return *(*set("a-z") >> ch('\n'));
+}
+
+}
+
+TEST_F(FileTest, mmap) {
+    std::string content("hello\nworld\n");
+    ASSERT_NO_FATAL_FAILURE(this->write(content));
+
+    InputFile file;
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.open(this->fileName.c_str())));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.mapped()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(content.size(), file.size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(content, std::string(file.begin(), file.end())));
+
+    auto state = createState(file.begin(), file.end());
+    auto r = Parser<rule::Lines>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(content.size(), state.consumedSize()));
+
+    InputFile file2(std::move(file));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, file.size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(content, std::string(file2.begin(), file2.end())));
+}
+
+TEST_F(FileTest, empty) {
+    InputFile file;
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.open(this->fileName.c_str(), InputFile::HUGE_PAGE)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, file.size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.begin() == file.end()));
+
+    // failed case
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(file.open("/tmp/not_found_aquarius_file")));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, file.size()));
+}
+
+TEST(file, pipe) {
+    int fds[2];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0, pipe(fds)));
+
+    std::string content("abc\ndef\n");
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(static_cast<ssize_t>(content.size()),
+                                      ::write(fds[1], content.data(), content.size())));
+    close(fds[1]);
+
+    InputFile file;
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.open(fds[0])));
+    close(fds[0]);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(file.mapped()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(content, std::string(file.begin(), file.end())));
+
+    InputFile file2;
+    file2 = std::move(file);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(content, std::string(file2.begin(), file2.end())));
+}
+
+#ifdef __linux__
+TEST(file, procfs) {
+    // size of procfs file is 0, but it has contents
+    InputFile file;
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.open("/proc/self/status")));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(file.mapped()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(file.size() > 0));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, std::string(file.begin(), file.end()).find("Name:")));
+}
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
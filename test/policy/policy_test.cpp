@@ -0,0 +1,410 @@
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <aquarius.hpp>
+
+namespace node {
+
+struct Leaf {
+    std::string value;
+
+    explicit Leaf(std::string &&value) : value(std::move(value)) { }
+};
+
+}
+
+namespace rule {
+
+using namespace aquarius;
+using namespace aquarius::ascii;
+
+AQ_DECL_RULE(Value, void);
+
+AQ_DEFINE_RULE(Array, void) {
+    return ch('[') >> repeat(nterm<Value>(), ch(',')) >> ch(']');
+}
+
+AQ_DEFINE_RULE(Number, void) {
+    return +set("0-9");
+}
+
+AQ_DEFINE_RULE(Value, void) {
+    return nterm<Number>() | nterm<Array>();
+}
+
+AQ_DEFINE_RULE(Digits, std::string) {
+    return text[ +set("0-9") ];
+}
+
+AQ_DEFINE_RULE(Leaf, ArenaPtr<node::Leaf>) {
+    return text[ +set("0-9") ] >> allocate<node::Leaf>();
+}
+
+AQ_DEFINE_RULE(Stmt, ArenaPtr<node::Leaf>) {
+    return nterm<Leaf>() >> ch(';');
+}
+
+}
+
+using namespace aquarius;
+
+struct FastEndPolicy : FastPolicy {
+    static constexpr bool trackEnd = true;
+};
+
+TEST(policy, fast) {
+    std::string input("[1,[2,3],x]");
+    auto state = createState<FastPolicy>(input.begin(), input.end());
+    auto r = Parser<rule::Value>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.failure() == state.begin()));   // not tracked
+    static_assert(sizeof(ParserState<const char *, FastPolicy>) + sizeof(unicode_util::ByteMap) ==
+                  sizeof(ParserState<const char *, DiagnosticPolicy>), "expected bytes are not stored");
+
+    input = "[1,[2,3]]";
+    auto r2 = Parser<rule::Value, FastPolicy>()(input.begin(), input.end());
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r2)));
+
+    // end of input is not tracked
+    input = "[1,";
+    state = createState<FastPolicy>(input.begin(), input.end());
+    Parser<rule::Value>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(state.reachedEnd()));
+
+    // unless enabled
+    auto state2 = createState<FastEndPolicy>(input.begin(), input.end());
+    Parser<rule::Value>()(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.reachedEnd()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.failure() == state2.begin()));
+}
+
+TEST(policy, diagnostic) {
+    std::string input("[1,[2,3],x]");
+    auto state = createState<DiagnosticPolicy>(input.begin(), input.end());
+    auto r = Parser<rule::Value>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(9, std::distance(state.begin(), state.failure())));
+
+    auto &expected = state.expected();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(expected.contains('[')));
+    for(unsigned char ch = '0'; ch <= '9'; ch++) {
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(expected.contains(ch)));
+    }
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(expected.contains(',')));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(expected.contains('x')));
+
+    // expected bytes at middle of string literal
+    input = "[1,2";
+    auto state2 = createState<DiagnosticPolicy>(input.begin(), input.end());
+    Parser<rule::Value>()(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4, std::distance(state2.begin(), state2.failure())));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.expected().contains(']')));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.expected().contains(',')));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state2.expected().contains('5')));
+}
+
+TEST(policy, instrumented) {
+    std::string input("[1,[2,3],[]]");
+    auto state = createState<InstrumentedPolicy>(input.begin(), input.end());
+    auto r = Parser<rule::Value>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+
+    auto &policy = state.policy();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(6u, policy.maxDepth()));   // Value > Array > Value > Array > Value > Number
+
+    auto &array = policy.stats()[ruleId<rule::Array>()];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_STREQ("Array", array.name));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, array.success));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(12u + 5u + 2u, array.consumed));
+
+    auto &number = policy.stats()[ruleId<rule::Number>()];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_STREQ("Number", number.name));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, number.success));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, number.failure));    // tried at each '[' and at ']' of "[]"
+
+    // value type rule
+    std::string input2("123");
+    auto state2 = createState<InstrumentedPolicy>(input2.begin(), input2.end());
+    auto r2 = Parser<rule::Digits>()(state2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("123", r2.get()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, state2.policy().maxDepth()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, state2.policy().stats()[ruleId<rule::Digits>()].consumed));
+}
+
+TEST(policy, profile) {
+    ProfileRegistry::instance().clear();
+
+    std::string input("[1,[2,3],[]]");
+    auto state = createState<ProfilePolicy>(input.begin(), input.end());
+    Parser<rule::Value>()(state);
+
+    std::string input2("[1,[2,3]");
+    auto state2 = createState<ProfilePolicy>(input2.begin(), input2.end());
+    Parser<rule::Value>()(state2);
+
+    auto profile = ProfileRegistry::instance().collect();
+    auto &array = profile.rules()[ruleId<rule::Array>()];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_STREQ("Array", array.name));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(6u, array.invocations));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, array.success));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, array.failure));    // also tried at ']' of "[]"
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(12u + 5u + 2u + 5u, array.consumed));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(8u, array.backtracked));   // "[1,[2,3]" is discarded
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(array.inclusiveCycles >= array.exclusiveCycles));
+
+    auto &value = profile.rules()[ruleId<rule::Value>()];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(value.inclusiveCycles >= array.inclusiveCycles));
+
+    // merged from other thread
+    std::thread th([] {
+        std::string input("[1]");
+        auto state = createState<ProfilePolicy>(input.begin(), input.end());
+        Parser<rule::Value>()(state);
+    });
+    th.join();
+    profile = ProfileRegistry::instance().collect();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(7u, profile.rules()[ruleId<rule::Array>()].invocations));
+
+    auto table = profile.toTable();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_NE(std::string::npos, table.find("Array")));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_NE(std::string::npos, table.find("Number")));
+
+    auto tsv = profile.toTSV();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, tsv.find("rule\tcalls\t")));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4, std::count(tsv.begin(), tsv.end(), '\n')));    // header + 3 rules
+}
+
+TEST(policy, sampling) {
+    std::string input("[1,[2,3],[]]");
+    auto state = createState<SamplingPolicy>(input.begin(), input.end());
+    auto r = Parser<rule::Value>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(state.policy().stack().empty()));
+
+    // distinct stacks
+    auto &tree = state.policy().callTree();
+    std::vector<std::string> stacks;
+    for(auto &node : tree.nodes()) {
+        std::string str;
+        for(auto *n = &node; n != &tree.nodes()[CallTree::ROOT]; n = &tree.nodes()[n->parent]) {
+            str = str.empty() ? n->name : std::string(n->name) + ";" + str;
+        }
+        stacks.push_back(std::move(str));
+    }
+    std::sort(stacks.begin(), stacks.end());
+    std::vector<std::string> expected = {
+            "", "Value", "Value;Array", "Value;Array;Value", "Value;Array;Value;Array",
+            "Value;Array;Value;Array;Value", "Value;Array;Value;Array;Value;Array",   // tried at ']' of "[]"
+            "Value;Array;Value;Array;Value;Number",
+            "Value;Array;Value;Number", "Value;Number",
+    };
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(expected, stacks));
+
+    // every event is sampled
+    auto collapsed = tree.toCollapsed();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_NE(std::string::npos, collapsed.find("\nValue;Array;Value;Number ")));
+
+    // merge
+    CallTree tree2;
+    tree2.merge(tree);
+    tree2.merge(tree);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(tree.nodes().size(), tree2.nodes().size()));
+    std::uint64_t w1 = 0;
+    std::uint64_t w2 = 0;
+    for(auto &e : tree.nodes()) {
+        w1 += e.weight;
+    }
+    for(auto &e : tree2.nodes()) {
+        w2 += e.weight;
+    }
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(w1 * 2, w2));
+}
+
+TEST(policy, trace) {
+    std::string input("[1,x]");
+    auto state = createState<TracePolicy<8, FastPolicy>>(input.begin(), input.end());
+    auto r = Parser<rule::Value>()(state);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+
+    // Value(0) > Number(0) fail, Array(0) > Value(1) > Number(1) exit, Value(3) > ...
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(16u, state.policy().count()));
+    const char *expected = "... 8 events are dropped\n"
+                           "enter Value @3\n"
+                           "enter Number @3\n"
+                           "fail Number @3\n"
+                           "enter Array @3\n"
+                           "fail Array @3\n"
+                           "fail Value @3\n"
+                           "fail Array @0\n"
+                           "fail Value @0\n";
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(expected, state.policy().dump()));
+}
+
+TEST(policy, error) {
+    std::string input("[1,[2,3],x]");
+    ParseError error;
+    auto r = Parser<rule::Value>()(input.begin(), input.end(), error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(9u, error.offset));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(9u, r.failureOffset()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, r.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, error.line));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(10u, error.column));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(error.reachedEnd));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1:10: expected '0'-'9', '[' or ']', but found 'x'", error.message()));
+
+    input = "[1,\n";
+    r = Parser<rule::Value>()(input.begin(), input.end(), error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1:4: expected '0'-'9', '[' or ']', but found \\x0A", error.message()));
+
+    input = "[1,2";
+    r = Parser<rule::Value>()(input.begin(), input.end(), error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(error.reachedEnd));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1:5: expected ',', '0'-'9' or ']', but found end of input", error.message()));
+
+    // line and column
+    {
+        using namespace ascii;
+        constexpr auto p = *set(" \n") >> ch('x');
+
+        input = "  \n\n  y";
+        auto state = createState<DiagnosticPolicy>(input.begin(), input.end());
+        p(state);
+        error = createError(state);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("3:3: expected \\x0A, ' ' or 'x', but found 'y'", error.message()));
+    }
+
+    // value type
+    input = "12a";
+    ParseError error2;
+    auto r2 = Parser<rule::Digits>()(input.begin(), input.end(), error2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r2)));    // not full match
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("12", r2.get()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, error2.offset));   // not set
+
+    input = "";
+    r2 = Parser<rule::Digits>()(input.begin(), input.end(), error2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r2)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1:1: expected '0'-'9', but found end of input", error2.message()));
+
+    input = "[12,3";
+    r = Parser<rule::Value>()(input.begin(), input.end(), error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, error.offset));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, r.failureOffset()));
+}
+
+static unsigned int enterCount = 0;
+
+struct CountPolicy : PolicyBase {
+    static constexpr bool hookRule = true;
+
+    void enterRule(std::uint32_t, const char *, std::size_t) {
+        enterCount++;
+    }
+};
+
+TEST(policy, error2) {
+    // both phases keep policy of parser
+    std::string input("[1,x]");
+    enterCount = 0;
+    Parser<rule::Value, CountPolicy>()(input.begin(), input.end());
+    const unsigned int count = enterCount;
+
+    ParseError error;
+    enterCount = 0;
+    auto r = Parser<rule::Value, CountPolicy>()(input.begin(), input.end(), error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, error.offset));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(count * 2, enterCount));
+
+    // error is reset after success
+    input = "[1,2]";
+    r = Parser<rule::Value, CountPolicy>()(input.begin(), input.end(), error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, error.offset));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1:1: found \\x00", error.message()));
+
+    // arena
+    Arena arena;
+    input = "123";
+    auto r2 = Parser<rule::Leaf, ArenaPolicy<>>()(input.begin(), input.end(), arena, error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r2)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("123", r2.get()->value));
+
+    input = "x";
+    r2 = Parser<rule::Leaf>()(input.begin(), input.end(), arena, error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r2)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("1:1: expected '0'-'9', but found 'x'", error.message()));
+
+    // allocations of failed parse are rolled back
+    input = "12x";
+    const auto checkpoint = arena.checkpoint();
+    r2 = Parser<rule::Stmt>()(input.begin(), input.end(), arena, error);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r2)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, error.offset));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(arena.checkpoint().cursor == checkpoint.cursor));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(arena.checkpoint().dtor == checkpoint.dtor));
+}
+
+TEST(policy, offset) {
+    std::string input("[1,2]x");
+    auto r = Parser<rule::Value>()(input.begin(), input.end());
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, r.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, r.failureOffset()));
+
+    // full match
+    r = Parser<rule::Value>().parseAll(input.begin(), input.end());
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, r.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, r.failureOffset()));
+
+    r = Parser<rule::Value>().parseAll(input.begin(), input.end() - 1);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, r.consumedSize()));
+
+    r = Parser<rule::Value>()(input.begin(), input.begin() + 3);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, r.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, r.failureOffset()));
+
+    // back-to-back records
+    input = "[1,[2]]12[]3";
+    std::vector<std::size_t> sizes;
+    std::size_t offset = 0;
+    while(offset < input.size()) {
+        auto r2 = Parser<rule::Value>().parseFrom(input.begin(), input.end(), offset);
+        ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r2)));
+        sizes.push_back(r2.consumedSize());
+        offset += r2.consumedSize();
+    }
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ((std::vector<std::size_t>{7, 2, 2, 1}), sizes));
+
+    input = "12[3,x";
+    auto r3 = Parser<rule::Digits>().parseFrom(input.begin(), input.end(), 3);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r3)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("3", r3.get()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, r3.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, r3.failureOffset()));
+
+    r = Parser<rule::Value>().parseFrom(input.begin(), input.end(), 2);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(5u, r.failureOffset()));   // relative to beginning of input
+
+    // move
+    auto r4(std::move(r3));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, r4.consumedSize()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, r4.failureOffset()));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
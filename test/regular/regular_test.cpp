@@ -0,0 +1,134 @@
+#include <deque>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <aquarius.hpp>
+
+namespace rule {
+
+using namespace aquarius;
+using namespace aquarius::ascii;
+
+AQ_DEFINE_RULE(Number, std::string) {
+    return text[ dfa[ -ch('-') >> (ch('0') | set("1-9") >> *set("0-9")) >>
+                      -(ch('.') >> +set("0-9")) >> -(set("eE") >> -set("+-") >> +set("0-9")) ] ];
+}
+
+AQ_DEFINE_RULE(Numbers, std::vector<std::string>) {
+    return repeat(nterm<Number>(), ch(','));
+}
+
+}
+
+using namespace aquarius;
+using namespace aquarius::ascii;
+
+constexpr auto number = -ch('-') >> (ch('0') | set("1-9") >> *set("0-9")) >>
+                        -(ch('.') >> +set("0-9")) >> -(set("eE") >> -set("+-") >> +set("0-9"));
+
+/**
+ * all of strings over alphabet which length is less than or equal to size
+ */
+static std::vector<std::string> enumerate(const std::string &alphabet, unsigned int size) {
+    std::vector<std::string> values = {""};
+    for(std::size_t i = 0; i < values.size(); i++) {
+        if(values[i].size() == size) {
+            continue;
+        }
+        for(char c : alphabet) {
+            values.push_back(values[i] + c);
+        }
+    }
+    return values;
+}
+
+/**
+ * automaton must report same result, consumed size, failure position and end of input as original one
+ */
+template <typename Policy, typename T, typename C, typename Iterator>
+static void assertSameMatch(const T &expr, const C &automaton, Iterator begin, Iterator end) {
+    auto state = createState<Policy>(begin, end);
+    expr(state);
+    auto state2 = createState<Policy>(begin, end);
+    automaton(state2);
+
+    ASSERT_EQ(state.result(), state2.result());
+    ASSERT_EQ(state.consumedSize(), state2.consumedSize());
+    if(Policy::trackFailure) {  // if not tracked, end of input is conservative
+        ASSERT_EQ(state.reachedEnd(), state2.reachedEnd());
+        ASSERT_EQ(std::distance(state.begin(), state.failure()), std::distance(state2.begin(), state2.failure()));
+    }
+}
+
+template <typename T>
+static void assertSameMatch(const T &expr, const std::vector<std::string> &inputs) {
+    const auto automaton = dfa[ expr ];
+    for(auto &input : inputs) {
+        SCOPED_TRACE("input: " + input);
+        ASSERT_NO_FATAL_FAILURE(assertSameMatch<DefaultPolicy>(expr, automaton, input.begin(), input.end()));
+        ASSERT_NO_FATAL_FAILURE(assertSameMatch<FastPolicy>(expr, automaton, input.begin(), input.end()));
+        ASSERT_NO_FATAL_FAILURE(assertSameMatch<DiagnosticPolicy>(expr, automaton, input.begin(), input.end()));
+
+        std::deque<char> deque(input.begin(), input.end());
+        ASSERT_NO_FATAL_FAILURE(assertSameMatch<DefaultPolicy>(expr, automaton, deque.begin(), deque.end()));
+    }
+}
+
+TEST(regular, build) {
+    constexpr auto p = dfa[ number ];
+    static_assert(!p.nullable() && p.firstSet().contains('-') && !p.firstSet().contains('+'), "");
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(p.automaton.valid));
+
+    constexpr auto p2 = dfa[ (ascii::str("true") | ascii::str("false")) >> *(ch(' ') | ch('\t')) ];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(p2.automaton.valid));
+
+    // ambiguous alternatives need backtracking
+    constexpr auto p3 = dfa[ ascii::str("ab") >> ch('c') | ascii::str("ab") >> ch('d') | ch('a') ];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(p3.automaton.valid));
+
+    // repetition of nullable expression is not supported
+    constexpr auto p4 = dfa[ *(-ch('a') | ch('b')) >> ch('c') ];
+    ASSERT_NO_FATAL_FAILURE(ASSERT_FALSE(p4.automaton.valid));
+}
+
+TEST(regular, match) {
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(number, enumerate("01-.e+", 5)));
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(number, {"-0.5e+12", "12345678901234567890", "3.", "1e", "-", "0x"}));
+
+    // string literal reports short input
+    constexpr auto keyword = (str("true") | str("false") | str("null")) >> -ch(';');
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(keyword, enumerate("trufalsn;", 3)));
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(keyword, {"true", "false;", "nul", "nulx", "truex", "fals"}));
+
+    // failure after consumption needs backtracking
+    constexpr auto pair = *(ch('a') >> ch('b')) >> -(ch('c') >> ch('d') >> ch('e'));
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(pair, enumerate("abcde", 5)));
+
+    constexpr auto nested = +(str("xy") | ch('z') >> *(ch('w') >> -ch('v'))) >> (ch(';') | ch('.') >> ch('.'));
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(nested, enumerate("xyzwv;.", 5)));
+
+    constexpr auto ambiguous = str("ab") >> ch('c') | str("ab") >> ch('d') | ch('a');
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(ambiguous, enumerate("abcd", 4)));
+
+    constexpr auto fixed = repeat<3, 3>(set("0-9a-f")) >> (ch('-') | ch('+')) >> -repeat<2, 2>(ch('x'));
+    ASSERT_NO_FATAL_FAILURE(assertSameMatch(fixed, enumerate("0a-+x", 5)));
+}
+
+TEST(regular, rule) {
+    std::string input("12,-0.5,3e+2,7.");
+    auto r = Parser<rule::Numbers>()(input.begin(), input.end());
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(r)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, r.get().size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("-0.5", r.get()[1]));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("7", r.get()[3]));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(14u, r.consumedSize()));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
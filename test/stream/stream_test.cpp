@@ -0,0 +1,143 @@
+#include <sstream>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+#include <aquarius.hpp>
+
+namespace rule {
+
+using namespace aquarius;
+using namespace aquarius::ascii;
+
+AQ_DEFINE_RULE(Number, std::string) {
+    return *set(" \n") >> text[ +set("0-9") ] >> ch(';');
+}
+
+AQ_DEFINE_RULE(Bool, void) {
+    return (str("true") | str("false")) >> ch(';');
+}
+
+}
+
+using namespace aquarius;
+
+TEST(stream, chunk1) {
+    StreamParser<rule::Number> parser;
+    ParsedResult<std::string> result;
+    std::vector<std::string> values;
+
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser.next(result)));
+
+    std::string input("12;345; 6789;\n0;");
+    for(char ch : input) {
+        parser.feed(&ch, 1);
+        while(parser.next(result) == StreamStatus::MATCHED) {
+            values.push_back(std::move(result.get()));
+        }
+    }
+    parser.finish();
+    while(parser.next(result) == StreamStatus::MATCHED) {
+        values.push_back(std::move(result.get()));
+    }
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::END, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(0u, parser.bufferedSize()));
+
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4u, values.size()));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("12", values[0]));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("345", values[1]));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("6789", values[2]));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ("0", values[3]));
+}
+
+TEST(stream, chunk2) {
+    StreamParser<rule::Bool> parser;
+    ParsedResult<void> result;
+
+    parser.feed("true;fa", 7);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::MATCHED, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_TRUE(static_cast<bool>(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(2u, parser.bufferedSize()));
+
+    parser.feed("lse;tru", 7);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::MATCHED, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser.next(result)));
+
+    // failed case
+    parser.finish();
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::FAILED, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(3u, parser.bufferedSize()));
+}
+
+TEST(stream, retry) {
+    std::string record(97, '1');
+    record = "\n\n" + record + ";";
+
+    // completed record is reported as soon as it is fed
+    StreamParser<rule::Number> parser;
+    ParsedResult<std::string> result;
+    parser.feed(record.data(), 60);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser.next(result)));
+    parser.feed(record.data() + 60, 40);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::MATCHED, parser.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(97u, result.get().size()));
+
+    // deferred until buffered input is doubled
+    StreamParser<rule::Number> parser2(true);
+    parser2.feed(record.data(), 60);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser2.next(result)));
+    parser2.feed(record.data() + 60, 40);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::NEED_MORE_INPUT, parser2.next(result)));
+    parser2.feed(record.data(), 20);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::MATCHED, parser2.next(result)));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(97u, result.get().size()));
+}
+
+TEST(stream, iterator) {
+    std::string input;
+    for(unsigned int i = 0; i < 1000; i++) {
+        input += "\n";
+        input += std::to_string(i);
+        input += ";";
+    }
+
+    std::istringstream stream(input);
+    StreamParser<rule::Number> parser;
+    unsigned int count = 0;
+    auto s = parser.parse(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>(),
+                          [&](ParsedResult<std::string> &&r) {
+                              ASSERT_EQ(std::to_string(count), r.get());
+                              count++;
+                          }, 64);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::END, s));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1000u, count));
+
+    // chunk larger than default size
+    stream = std::istringstream(input);
+    StreamParser<rule::Number> parser3;
+    std::size_t buffered = 0;
+    s = parser3.parse(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>(),
+                      [&](ParsedResult<std::string> &&) {
+                          if(buffered == 0) {
+                              buffered = parser3.bufferedSize();
+                          }
+                      }, 4500);
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::END, s));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(4500u - 3u, buffered));
+
+    // failed case
+    stream = std::istringstream("12;34:");
+    StreamParser<rule::Number> parser2;
+    count = 0;
+    s = parser2.parse(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>(),
+                      [&](ParsedResult<std::string> &&) { count++; });
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(StreamStatus::FAILED, s));
+    ASSERT_NO_FATAL_FAILURE(ASSERT_EQ(1u, count));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}